@@ -0,0 +1,60 @@
+# dplnk_generate_registration(<target> PROTOCOL <scheme>
+#                             [PATH <installed program>]
+#                             [VALUES <key>=<value>...]
+#                             [OUTPUT_DIRECTORY <dir>])
+#
+# Writes at build time what `dplnk::dplnk` would register at run time, for installers to apply directly:
+# <scheme>.reg, dplnk-<scheme>.desktop and <scheme>-mimeapps.list. PATH defaults to the target's file,
+# which an installer usually wants to override with the installed location. The generated files are
+# listed in the target's DPLNK_REGISTRATION_FILES property.
+#
+# When cross-compiling, set DPLNK_GEN_EXECUTABLE to a dplnk-gen built for the host.
+function(dplnk_generate_registration TARGET)
+	cmake_parse_arguments(PARSE_ARGV 1 ARG "" "PROTOCOL;PATH;OUTPUT_DIRECTORY" "VALUES")
+
+	if (NOT ARG_PROTOCOL)
+		message(FATAL_ERROR "dplnk_generate_registration: PROTOCOL is required")
+	endif()
+	if (NOT ARG_PROTOCOL MATCHES "^[A-Za-z][A-Za-z0-9+.-]*$")
+		message(FATAL_ERROR "dplnk_generate_registration: '${ARG_PROTOCOL}' is not a valid URL scheme")
+	endif()
+
+	if (NOT ARG_PATH)
+		set(ARG_PATH "$<TARGET_FILE:${TARGET}>")
+	endif()
+	if (NOT ARG_OUTPUT_DIRECTORY)
+		set(ARG_OUTPUT_DIRECTORY "${CMAKE_CURRENT_BINARY_DIR}/dplnk")
+	endif()
+
+	if (DPLNK_GEN_EXECUTABLE)
+		set(generator "${DPLNK_GEN_EXECUTABLE}")
+	elseif (TARGET dplnk-gen)
+		set(generator "$<TARGET_FILE:dplnk-gen>")
+	else()
+		message(FATAL_ERROR "dplnk_generate_registration: enable DPLNK_BUILD_TOOLS or set DPLNK_GEN_EXECUTABLE")
+	endif()
+
+	set(values)
+	foreach(value IN LISTS ARG_VALUES)
+		list(APPEND values --value "${value}")
+	endforeach()
+
+	# Desktop file ids use the lowercase scheme, like registration does
+	string(TOLOWER "${ARG_PROTOCOL}" scheme)
+	set(outputs
+		"${ARG_OUTPUT_DIRECTORY}/${ARG_PROTOCOL}.reg"
+		"${ARG_OUTPUT_DIRECTORY}/dplnk-${scheme}.desktop"
+		"${ARG_OUTPUT_DIRECTORY}/${ARG_PROTOCOL}-mimeapps.list"
+	)
+
+	add_custom_command(
+		OUTPUT ${outputs}
+		COMMAND "${generator}" --protocol "${ARG_PROTOCOL}" --path "${ARG_PATH}" ${values} --output "${ARG_OUTPUT_DIRECTORY}"
+		DEPENDS "${generator}"
+		COMMENT "Generating the ${ARG_PROTOCOL}:// registration files for ${TARGET}"
+		VERBATIM
+	)
+
+	add_custom_target(${TARGET}-dplnk-registration ALL DEPENDS ${outputs})
+	set_property(TARGET ${TARGET} APPEND PROPERTY DPLNK_REGISTRATION_FILES ${outputs})
+endfunction()
@@ -0,0 +1,111 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <memory_resource>
+#include <mutex>
+#include <new>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace dplnk {
+	// Bump allocator over a single block. Deallocation is a no-op, `reset` frees everything at once.
+	// Requests that do not fit fall through to the upstream resource and are counted, so the block
+	// size can be tuned until steady state never touches the general-purpose heap.
+	class arena : public std::pmr::memory_resource {
+	public:
+		explicit arena(std::size_t capacity, std::pmr::memory_resource* upstream = std::pmr::new_delete_resource());
+		~arena() override;
+
+		arena(const arena&) = delete;
+		arena& operator=(const arena&) = delete;
+
+		void reset() noexcept;
+
+		[[nodiscard]] std::size_t capacity() const noexcept { return size; }
+		[[nodiscard]] std::size_t used() const noexcept { return offset; }
+		[[nodiscard]] std::uint64_t overflows() const noexcept { return spilled; }
+
+		template<typename T, typename... Args>
+		[[nodiscard]] T* make(Args&&... args) {
+			static_assert(std::is_trivially_destructible_v<T>, "dplnk::arena never runs destructors");
+			return ::new (allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+		}
+
+		[[nodiscard]] std::string_view copy(std::string_view text);
+
+	private:
+		void* do_allocate(std::size_t bytes, std::size_t alignment) override;
+		void do_deallocate(void* p, std::size_t bytes, std::size_t alignment) override;
+		[[nodiscard]] bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override;
+
+		struct spill {
+			void* p;
+			std::size_t bytes;
+			std::size_t alignment;
+		};
+
+		std::pmr::memory_resource* upstream;
+		std::byte* block;
+		std::size_t size;
+		std::size_t offset = 0;
+
+		std::vector<spill> spills;
+		std::uint64_t spilled = 0;
+	};
+
+	struct arena_pool_options {
+		std::size_t arena_size = 16 * 1024;
+		// Arenas kept for reuse, extra ones are freed when released
+		std::size_t max_arenas = 8;
+		// Arenas allocated up front
+		std::size_t preallocate = 2;
+	};
+
+	class arena_pool {
+	public:
+		explicit arena_pool(arena_pool_options options = {});
+
+		arena_pool(const arena_pool&) = delete;
+		arena_pool& operator=(const arena_pool&) = delete;
+
+		// Thread safe
+		[[nodiscard]] arena* acquire();
+		void release(arena* arena) noexcept;
+
+		[[nodiscard]] std::size_t idle() const;
+		[[nodiscard]] std::size_t footprint() const;
+
+	private:
+		arena_pool_options options;
+
+		mutable std::mutex mutex;
+		std::vector<std::unique_ptr<arena>> owned;
+		std::vector<arena*> available;
+	};
+
+	// Returns its arena to the pool when it goes out of scope
+	class pooled_arena {
+	public:
+		explicit pooled_arena(arena_pool& pool) : pool{ &pool }, memory{ pool.acquire() } {}
+		~pooled_arena() {
+			if (memory != nullptr) {
+				pool->release(memory);
+			}
+		}
+
+		pooled_arena(pooled_arena&& other) noexcept : pool{ other.pool }, memory{ std::exchange(other.memory, nullptr) } {}
+		pooled_arena& operator=(pooled_arena&&) = delete;
+
+		[[nodiscard]] arena& operator*() const noexcept { return *memory; }
+		[[nodiscard]] arena* operator->() const noexcept { return memory; }
+		[[nodiscard]] arena* get() const noexcept { return memory; }
+
+	private:
+		arena_pool* pool;
+		arena* memory;
+	};
+} // namespace dplnk
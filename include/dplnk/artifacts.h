@@ -0,0 +1,23 @@
+#pragma once
+
+#include "dplnk.h"
+
+#include <string>
+
+namespace dplnk {
+	// What `dplnk(path, options)` writes, as files an installer applies itself so the first launch does no registration
+	struct registration_artifacts {
+		// A regedit script for the same HKEY_CLASSES_ROOT keys and values, UTF-8 (`dplnk-gen` writes it as UTF-16)
+		std::string reg;
+
+		// Goes into an XDG `applications` directory under this name
+		std::string desktop_file_name;
+		std::string desktop_file;
+
+		// The `[Default Applications]` and `[Added Associations]` lines to merge into mimeapps.list
+		std::string mimeapps;
+	};
+
+	// `path` is where the installer puts the program, which is usually not where it was built
+	[[nodiscard]] registration_artifacts generate_registration(const std::string& path, const options& options);
+} // namespace dplnk
@@ -0,0 +1,65 @@
+#pragma once
+
+#include "dplnk.h"
+
+#include <chrono>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <string>
+
+namespace dplnk {
+	enum class launch_policy {
+		immediate,  // start on the background thread right away
+		until_idle, // wait for `notify_idle()` (or `idle_timeout`) before touching the registry
+	};
+
+	enum class registration_status {
+		pending,
+		running,
+		completed,
+		failed,
+		cancelled,
+	};
+
+	struct async_options {
+		launch_policy policy = launch_policy::immediate;
+		std::chrono::milliseconds idle_timeout{ 10000 };
+		// Invoked on the background thread once the registration has settled
+		std::function<void(registration_status)> on_complete;
+	};
+
+	namespace detail {
+		struct registration_state;
+	} // namespace detail
+
+	// Handle to a registration running on a background thread; copies share the same state
+	class registration {
+	public:
+		registration() noexcept = default;
+		explicit registration(std::shared_ptr<detail::registration_state> state) noexcept;
+
+		// Non-blocking, safe to call every frame
+		[[nodiscard]] registration_status status() const noexcept;
+		[[nodiscard]] bool ready() const noexcept;
+
+		// Only effective before the work has started, returns whether it was cancelled
+		bool cancel() noexcept;
+
+		void wait() const;
+		[[nodiscard]] bool wait_for(std::chrono::milliseconds timeout) const;
+
+		// Waits, then rethrows the failure (if any) of the underlying `dplnk::dplnk` call
+		void get() const;
+
+		[[nodiscard]] explicit operator bool() const noexcept;
+
+	private:
+		std::shared_ptr<detail::registration_state> state;
+	};
+
+	registration register_async(const std::string& path, options options, async_options async = {});
+
+	// Releases every registration deferred with `launch_policy::until_idle` so far. Later ones wait for the next call.
+	void notify_idle() noexcept;
+} // namespace dplnk
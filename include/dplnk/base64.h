@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstddef>
+#include <optional>
+#include <span>
+#include <string_view>
+
+namespace dplnk {
+	// Unpadded base64url (RFC 4648 section 5), the form tokens take inside links
+
+	[[nodiscard]] constexpr std::size_t base64url_encoded_size(std::size_t bytes) noexcept {
+		return bytes / 3 * 4 + (bytes % 3 == 0 ? 0 : bytes % 3 + 1);
+	}
+
+	// Only meaningful for lengths a valid encoding can have (`chars % 4 != 1`)
+	[[nodiscard]] constexpr std::size_t base64url_decoded_size(std::size_t chars) noexcept {
+		return chars / 4 * 3 + (chars % 4 == 0 ? 0 : chars % 4 - 1);
+	}
+
+	// Returns the number of characters written, or nothing if `out` is too small
+	[[nodiscard]] std::optional<std::size_t> base64url_encode(std::span<const std::byte> in, std::span<char> out) noexcept;
+
+	// Returns the number of bytes written, or nothing if `in` is not strictly valid unpadded
+	// base64url (bad characters, padding, impossible length or non-zero trailing bits) or `out` is too small
+	[[nodiscard]] std::optional<std::size_t> base64url_decode(std::string_view in, std::span<std::byte> out) noexcept;
+
+	namespace detail {
+		// The widest kernel the codec may use, so benchmarks can compare them on one machine.
+		// One the CPU lacks falls back to the next narrower kernel.
+		enum class base64_kernel {
+			scalar,
+			ssse3,
+			avx2,
+			best,
+		};
+
+		[[nodiscard]] bool supports(base64_kernel kernel) noexcept;
+
+		[[nodiscard]] std::optional<std::size_t> base64url_encode(std::span<const std::byte> in, std::span<char> out, base64_kernel kernel) noexcept;
+		[[nodiscard]] std::optional<std::size_t> base64url_decode(std::string_view in, std::span<std::byte> out, base64_kernel kernel) noexcept;
+	} // namespace detail
+
+	// Decodes the query parameter `key` of `link` straight from the link text
+	[[nodiscard]] std::optional<std::size_t> base64url_decode_param(std::string_view link, std::string_view key, std::span<std::byte> out) noexcept;
+} // namespace dplnk
@@ -0,0 +1,199 @@
+#pragma once
+
+#include "link.h"
+#include "scheme.h"
+
+#include <charconv>
+#include <cstddef>
+#include <cstdint>
+#include <expected>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+namespace dplnk {
+	// Binds the query parameter `Name` to the data member `Member`
+	template<fixed_string Name, auto Member>
+	struct field {
+		static constexpr std::string_view name = Name.view();
+		static constexpr auto member = Member;
+	};
+
+	// Describes how the query parameters of a link map onto the aggregate `T`, e.g.
+	// `using join_query = dplnk::schema<join, dplnk::field<"id", &join::id>, dplnk::field<"region", &join::region>>;`
+	template<typename T, typename... Fields>
+	struct schema {
+		static_assert(sizeof...(Fields) <= 64, "dplnk::schema supports at most 64 fields");
+
+		using type = T;
+	};
+
+	enum class unknown_keys {
+		ignore,
+		reject,
+	};
+
+	enum class missing_keys {
+		reject,
+		keep_default, // leave the member value-initialized
+	};
+
+	struct bind_policy {
+		unknown_keys unknown = unknown_keys::ignore;
+		missing_keys missing = missing_keys::reject;
+	};
+
+	enum class bind_errc {
+		unknown_key,
+		missing_key,
+		duplicate_key,
+		invalid_value,
+	};
+
+	struct bind_error {
+		bind_errc code;
+		std::string_view key;
+	};
+
+	namespace detail {
+		template<typename>
+		struct member_type;
+
+		template<typename Class, typename Member>
+		struct member_type<Member Class::*> {
+			using type = Member;
+		};
+
+		template<typename>
+		inline constexpr bool is_optional = false;
+
+		template<typename T>
+		inline constexpr bool is_optional<std::optional<T>> = true;
+
+		// `std::string_view` members see the raw text, `std::string` members the percent-decoded text
+		template<typename T>
+		[[nodiscard]] bool parse_value(std::string_view text, T& value) {
+			if constexpr (is_optional<T>) {
+				return parse_value(text, value.emplace());
+			} else if constexpr (std::is_same_v<T, std::string_view>) {
+				value = text;
+				return true;
+			} else if constexpr (std::is_same_v<T, std::string>) {
+				value.resize(text.size());
+				const auto size = percent_decode(text, value.data());
+				if (!size) {
+					return false;
+				}
+				value.resize(*size);
+				return true;
+			} else if constexpr (std::is_same_v<T, bool>) {
+				if (text == "1" || text == "true") {
+					value = true;
+					return true;
+				}
+				if (text == "0" || text == "false") {
+					value = false;
+					return true;
+				}
+				return false;
+			} else if constexpr (std::is_enum_v<T>) {
+				std::underlying_type_t<T> underlying{};
+				if (!parse_value(text, underlying)) {
+					return false;
+				}
+				value = static_cast<T>(underlying);
+				return true;
+			} else if constexpr (std::is_arithmetic_v<T>) {
+				const auto [end, error] = std::from_chars(text.data(), text.data() + text.size(), value);
+				return error == std::errc{} && end == text.data() + text.size();
+			} else {
+				static_assert(sizeof(T) == 0, "dplnk::bind: unsupported member type");
+			}
+		}
+
+		template<typename Schema>
+		struct binder;
+
+		template<typename T, typename... Fields>
+		struct binder<schema<T, Fields...>> {
+			static std::expected<T, bind_error> bind(std::string_view query, bind_policy policy) {
+				T result{};
+				std::uint64_t seen = 0;
+
+				while (!query.empty()) {
+					const auto amp = query.find('&');
+					const std::string_view pair = query.substr(0, amp);
+					query = amp == std::string_view::npos ? std::string_view{} : query.substr(amp + 1);
+
+					if (pair.empty()) {
+						continue;
+					}
+
+					const auto equals = pair.find('=');
+					const std::string_view key = pair.substr(0, equals);
+					const std::string_view value = equals == std::string_view::npos ? std::string_view{} : pair.substr(equals + 1);
+
+					std::optional<bind_errc> error;
+					if (!match(key, value, result, seen, error, std::index_sequence_for<Fields...>{})) {
+						if (policy.unknown == unknown_keys::reject) {
+							return std::unexpected(bind_error{ bind_errc::unknown_key, key });
+						}
+						continue;
+					}
+
+					if (error) {
+						return std::unexpected(bind_error{ *error, key });
+					}
+				}
+
+				std::optional<std::string_view> missing;
+				const auto check = [&]<std::size_t I, typename Field>() {
+					using member = typename member_type<std::remove_const_t<decltype(Field::member)>>::type;
+					if (!missing && !is_optional<member> && (seen & (std::uint64_t{ 1 } << I)) == 0) {
+						missing = Field::name;
+					}
+				};
+				[&]<std::size_t... I>(std::index_sequence<I...>) {
+					(check.template operator()<I, Fields>(), ...);
+				}(std::index_sequence_for<Fields...>{});
+
+				if (missing && policy.missing == missing_keys::reject) {
+					return std::unexpected(bind_error{ bind_errc::missing_key, *missing });
+				}
+
+				return result;
+			}
+
+			// Compares `key` against every field name; the names are constants, so this compiles to a length switch and memcmp
+			template<std::size_t... I>
+			static bool match(std::string_view key, std::string_view value, T& result, std::uint64_t& seen, std::optional<bind_errc>& error, std::index_sequence<I...>) {
+				return ((key == Fields::name && (assign<I, Fields>(value, result, seen, error), true)) || ...);
+			}
+
+			template<std::size_t I, typename Field>
+			static void assign(std::string_view value, T& result, std::uint64_t& seen, std::optional<bind_errc>& error) {
+				constexpr std::uint64_t bit = std::uint64_t{ 1 } << I;
+
+				if (seen & bit) {
+					error = bind_errc::duplicate_key;
+				} else if (!parse_value(value, result.*Field::member)) {
+					error = bind_errc::invalid_value;
+				}
+				seen |= bit;
+			}
+		};
+	} // namespace detail
+
+	// Parses a query string into `Schema::type` in a single pass, without an intermediate map
+	template<typename Schema>
+	[[nodiscard]] std::expected<typename Schema::type, bind_error> bind_query(std::string_view query, bind_policy policy = {}) {
+		return detail::binder<Schema>::bind(query, policy);
+	}
+
+	// Same as `bind_query` on the query of `link`
+	template<typename Schema>
+	[[nodiscard]] std::expected<typename Schema::type, bind_error> bind(std::string_view link, bind_policy policy = {}) {
+		return detail::binder<Schema>::bind(split_link(link).query, policy);
+	}
+} // namespace dplnk
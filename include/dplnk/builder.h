@@ -0,0 +1,86 @@
+#pragma once
+
+#include "scheme.h"
+
+#include <charconv>
+#include <cstddef>
+#include <memory_resource>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+namespace dplnk {
+	// Percent-encodes every byte outside the RFC 3986 unreserved set (`ALPHA DIGIT - . _ ~`), so the result never
+	// contains a `/`, `?`, `&`, `=` or `#` of its own. Returns the encoded length, or nothing if `out` is too small.
+	[[nodiscard]] std::optional<std::size_t> percent_encode(std::string_view in, std::span<char> out) noexcept;
+
+	// Composes an outbound link in one pass: `scheme://segment/segment?key=value&key=value#fragment`.
+	// Writes into a caller buffer, or into memory from a resource such as a `dplnk::arena` when it has to grow.
+	// Segments, keys, values and the fragment are percent-encoded, so `split_link`, `query_view` and `bind`
+	// read back exactly what was put in. Parts have to be added in that order.
+	class link_builder {
+	public:
+		// Nothing is allocated, `link` is empty once `buffer` runs out
+		link_builder(std::string_view protocol, std::span<char> buffer);
+		link_builder(std::string_view protocol, std::pmr::memory_resource& memory, std::size_t reserve = 128);
+
+		template<fixed_string Protocol>
+		link_builder(scheme<Protocol>, std::span<char> buffer) : link_builder{ scheme<Protocol>::protocol, buffer } {}
+
+		template<fixed_string Protocol>
+		link_builder(scheme<Protocol>, std::pmr::memory_resource& memory, std::size_t reserve = 128) : link_builder{ scheme<Protocol>::protocol, memory, reserve } {}
+
+		~link_builder();
+
+		link_builder(const link_builder&) = delete;
+		link_builder& operator=(const link_builder&) = delete;
+
+		link_builder& segment(std::string_view text);
+
+		// Numbers are written as `std::to_chars` does and booleans as `true`/`false`, the forms `bind` parses
+		template<typename T>
+		link_builder& param(std::string_view key, const T& value) {
+			if constexpr (std::is_convertible_v<const T&, std::string_view>) {
+				return encoded_param(key, value);
+			} else if constexpr (std::is_same_v<T, bool>) {
+				return plain_param(key, value ? "true" : "false");
+			} else if constexpr (std::is_enum_v<T>) {
+				return param(key, static_cast<std::underlying_type_t<T>>(value));
+			} else if constexpr (std::is_arithmetic_v<T>) {
+				char digits[64];
+				const auto [end, error] = std::to_chars(digits, digits + sizeof(digits), value);
+				return plain_param(key, { digits, static_cast<std::size_t>(end - digits) });
+			} else {
+				static_assert(sizeof(T) == 0, "dplnk::link_builder: unsupported parameter type");
+			}
+		}
+
+		link_builder& fragment(std::string_view text);
+
+		// The link so far, or nothing if a fixed buffer was too small
+		[[nodiscard]] std::optional<std::string_view> link() const noexcept;
+		[[nodiscard]] std::string str() const;
+
+	private:
+		enum class part { route, query, fragment };
+
+		link_builder& encoded_param(std::string_view key, std::string_view value);
+		link_builder& plain_param(std::string_view key, std::string_view value);
+
+		void enter(part next);
+		void append(std::string_view text);
+		void append_encoded(std::string_view text);
+		[[nodiscard]] bool reserve(std::size_t bytes);
+
+		std::pmr::memory_resource* memory = nullptr;
+		char* data = nullptr;
+		std::size_t capacity = 0;
+		std::size_t size = 0;
+
+		part current = part::route;
+		bool first = true;
+		bool overflow = false;
+	};
+} // namespace dplnk
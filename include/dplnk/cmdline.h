@@ -0,0 +1,212 @@
+#pragma once
+
+#include "trace.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <optional>
+#include <span>
+#include <string_view>
+#include <type_traits>
+
+namespace dplnk {
+	// Splits a Windows command line with the same rules as `CommandLineToArgvW`.
+	// Arguments are unescaped in place, so every returned view points into `line` itself
+	// (e.g. the buffer from `GetCommandLineW()`) and nothing is allocated.
+	template<typename Char>
+	class basic_argument_splitter {
+	public:
+		explicit basic_argument_splitter(std::span<Char> line) noexcept
+			: cursor{ line.data() }, end{ std::find(line.data(), line.data() + line.size(), Char{}) } {}
+
+		[[nodiscard]] std::optional<std::basic_string_view<Char>> next() noexcept {
+			if (first) {
+				first = false;
+				return cursor == end ? std::nullopt : std::optional{ program() };
+			}
+
+			if (cursor == end) {
+				return std::nullopt;
+			}
+
+			return argument();
+		}
+
+	private:
+		[[nodiscard]] static constexpr bool blank(Char c) noexcept { return c == Char(' ') || c == Char('\t'); }
+
+		void skip_blanks() noexcept {
+			while (cursor != end && blank(*cursor)) {
+				++cursor;
+			}
+		}
+
+		// The program name follows its own rules: quotes delimit it verbatim and backslashes are literal
+		[[nodiscard]] std::basic_string_view<Char> program() noexcept {
+			Char* const start = cursor;
+			Char* out = cursor;
+
+			if (*cursor == Char('"')) {
+				++cursor;
+				while (cursor != end && *cursor != Char('"')) {
+					*out++ = *cursor++;
+				}
+				if (cursor != end) {
+					++cursor;
+				}
+			} else {
+				while (cursor != end && !blank(*cursor)) {
+					++cursor;
+				}
+				out = cursor;
+			}
+
+			skip_blanks();
+			return { start, static_cast<std::size_t>(out - start) };
+		}
+
+		[[nodiscard]] std::basic_string_view<Char> argument() noexcept {
+			Char* const start = cursor;
+			Char* out = cursor;
+
+			std::size_t backslashes = 0;
+			int quotes = 0;
+
+			while (cursor != end) {
+				const Char c = *cursor;
+
+				if (blank(c) && quotes == 0) {
+					break;
+				}
+
+				if (c == Char('\\')) {
+					*out++ = c;
+					++backslashes;
+					++cursor;
+					continue;
+				}
+
+				if (c != Char('"')) {
+					*out++ = c;
+					backslashes = 0;
+					++cursor;
+					continue;
+				}
+
+				if (backslashes % 2 == 0) {
+					// 2n backslashes and a quote: n backslashes, the quote toggles quoting
+					out -= backslashes / 2;
+					++quotes;
+				} else {
+					// 2n+1 backslashes and a quote: n backslashes and a literal quote
+					out -= backslashes / 2 + 1;
+					*out++ = Char('"');
+				}
+				++cursor;
+				backslashes = 0;
+
+				// Every third quote in a run is literal, a run ending on two closes the quoted section
+				while (cursor != end && *cursor == Char('"')) {
+					if (++quotes == 3) {
+						*out++ = Char('"');
+						quotes = 0;
+					}
+					++cursor;
+				}
+				if (quotes == 2) {
+					quotes = 0;
+				}
+			}
+
+			skip_blanks();
+			return { start, static_cast<std::size_t>(out - start) };
+		}
+
+		Char* cursor;
+		Char* end;
+		bool first = true;
+	};
+
+	using argument_splitter = basic_argument_splitter<char>;
+	using wargument_splitter = basic_argument_splitter<wchar_t>;
+
+	// Splits all of `line` into `args`, returning how many arguments there were (which may exceed `args.size()`)
+	template<typename Char>
+	std::size_t split_command_line(std::span<Char> line, std::span<std::basic_string_view<Char>> args) noexcept {
+		basic_argument_splitter<Char> splitter{ line };
+
+		std::size_t count = 0;
+		while (const auto arg = splitter.next()) {
+			if (count < args.size()) {
+				args[count] = *arg;
+			}
+			++count;
+		}
+
+		return count;
+	}
+
+	namespace detail {
+		// Length of the `scheme` in a `scheme:...` argument, zero if there is none.
+		// Single letter schemes are rejected so that `C:\path` arguments are never mistaken for links.
+		template<typename Char>
+		[[nodiscard]] constexpr std::size_t link_scheme_length(std::basic_string_view<Char> arg) noexcept {
+			constexpr auto alpha = [](Char c) { return (c >= Char('a') && c <= Char('z')) || (c >= Char('A') && c <= Char('Z')); };
+			constexpr auto digit = [](Char c) { return c >= Char('0') && c <= Char('9'); };
+
+			if (arg.empty() || !alpha(arg.front())) {
+				return 0;
+			}
+
+			for (std::size_t i = 1; i < arg.size(); ++i) {
+				const Char c = arg[i];
+				if (c == Char(':')) {
+					return i >= 2 ? i : 0;
+				}
+				if (!alpha(c) && !digit(c) && c != Char('+') && c != Char('-') && c != Char('.')) {
+					return 0;
+				}
+			}
+
+			return 0;
+		}
+
+		template<typename Char>
+		[[nodiscard]] constexpr bool scheme_equals(std::basic_string_view<Char> scheme, std::string_view protocol) noexcept {
+			constexpr auto lower = [](auto c) { return (c >= 'A' && c <= 'Z') ? static_cast<char>(c - 'A' + 'a') : static_cast<char>(c); };
+
+			return scheme.size() == protocol.size() && std::equal(scheme.begin(), scheme.end(), protocol.begin(), [&](Char a, char b) {
+				return lower(a) == lower(b);
+			});
+		}
+	} // namespace detail
+
+	// The deep link the process was launched with through the registered `"<path>" %1` command, if any
+	template<typename Char>
+	[[nodiscard]] std::optional<std::basic_string_view<std::remove_const_t<Char>>> initial_link(int argc, Char* const* argv) noexcept {
+		DPLNK_TRACE_SPAN("initial_link");
+		for (int i = 1; i < argc; ++i) {
+			const std::basic_string_view<std::remove_const_t<Char>> arg{ argv[i] };
+			if (detail::link_scheme_length(arg) != 0) {
+				return arg;
+			}
+		}
+
+		return std::nullopt;
+	}
+
+	// Same as above, but only accepts links for `protocol` (compared case-insensitively)
+	template<typename Char>
+	[[nodiscard]] std::optional<std::basic_string_view<std::remove_const_t<Char>>> initial_link(std::string_view protocol, int argc, Char* const* argv) noexcept {
+		DPLNK_TRACE_SPAN("initial_link");
+		for (int i = 1; i < argc; ++i) {
+			const std::basic_string_view<std::remove_const_t<Char>> arg{ argv[i] };
+			const std::size_t length = detail::link_scheme_length(arg);
+			if (length != 0 && detail::scheme_equals(arg.substr(0, length), protocol)) {
+				return arg;
+			}
+		}
+
+		return std::nullopt;
+	}
+} // namespace dplnk
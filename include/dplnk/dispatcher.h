@@ -0,0 +1,225 @@
+#pragma once
+
+#include "arena.h"
+#include "journal.h"
+#include "link.h"
+#include "query.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+namespace dplnk {
+	enum class target {
+		main_thread, // time-sliced inside `dispatcher::run`
+		worker,      // the dispatcher's worker pool
+		deferred,    // held until `dispatcher::run_deferred`
+	};
+
+	// Handlers return `yield` to be resumed in a later slice, `done` once finished
+	enum class step {
+		done,
+		yield,
+	};
+
+	// Everything a handler sees lives in one pooled arena that is recycled once the handler is done
+	struct link_event {
+		std::string_view link;
+		std::string_view route;
+		std::string_view query;
+		std::uint64_t id = 0;
+
+		const query_view* params = nullptr;
+		arena* memory = nullptr;
+
+		// Percent-decoded value of `key`. A value without escapes is returned in place, any other is decoded into the
+		// event's arena again on every call, so keep the result instead of asking twice.
+		[[nodiscard]] std::optional<std::string_view> param(std::string_view key) const {
+			const auto raw = params->raw(key);
+			if (!raw || raw->find('%') == std::string_view::npos) {
+				return raw;
+			}
+
+			auto* const buffer = static_cast<char*>(memory->allocate(raw->size(), 1));
+			return params->value(key, { buffer, raw->size() });
+		}
+	};
+
+	using handler = std::function<step(const link_event&)>;
+
+	struct handler_options {
+		// A single step running longer than this counts as a watchdog overrun
+		std::chrono::microseconds budget{ 2000 };
+		dplnk::target target = dplnk::target::main_thread;
+	};
+
+	struct dispatcher_options {
+		std::size_t workers = 1;
+		arena_pool_options memory;
+		// Records every dispatched link and its outcome, must outlive the dispatcher
+		dplnk::journal* journal = nullptr;
+	};
+
+	struct watchdog_stats {
+		std::uint64_t steps = 0;
+		std::uint64_t overruns = 0;
+		std::chrono::nanoseconds worst{ 0 };
+	};
+
+	struct dispatch_stats {
+		std::uint64_t dispatched = 0;
+		std::uint64_t unhandled = 0;
+		std::uint64_t completed = 0;
+		std::uint64_t failed = 0;
+		watchdog_stats watchdog;
+	};
+
+	// Routes links to handlers by `route_of(link)`. Register handlers before dispatching.
+	class dispatcher {
+	public:
+		explicit dispatcher(dispatcher_options options = {});
+		~dispatcher();
+
+		dispatcher(const dispatcher&) = delete;
+		dispatcher& operator=(const dispatcher&) = delete;
+
+		void on(std::string route, handler handler, handler_options options = {});
+		void otherwise(handler handler, handler_options options = {});
+
+		// One-shot handlers that return nothing are run as a single step
+		template<typename Handler> requires std::is_void_v<std::invoke_result_t<Handler&, const link_event&>>
+		void on(std::string route, Handler handler, handler_options options = {}) {
+			on(std::move(route), dplnk::handler{ one_shot(std::move(handler)) }, options);
+		}
+
+		template<typename Handler> requires std::is_void_v<std::invoke_result_t<Handler&, const link_event&>>
+		void otherwise(Handler handler, handler_options options = {}) {
+			otherwise(dplnk::handler{ one_shot(std::move(handler)) }, options);
+		}
+
+		// Queues `link` for its handler's target, returns false if nothing handles it. Thread safe.
+		bool dispatch(std::string_view link, link_source source = link_source::api);
+
+		// Runs main-thread steps until `frame_budget` is spent (always at least one), returns the steps run
+		std::size_t run(std::chrono::microseconds frame_budget);
+
+		// Runs every deferred handler to completion on the calling thread
+		std::size_t run_deferred();
+
+		[[nodiscard]] std::size_t pending() const;
+		[[nodiscard]] dispatch_stats stats() const;
+		[[nodiscard]] watchdog_stats watchdog(std::string_view route) const;
+
+	private:
+		struct entry {
+			dplnk::handler handler;
+			handler_options options;
+
+			std::atomic<std::uint64_t> steps{ 0 };
+			std::atomic<std::uint64_t> overruns{ 0 };
+			std::atomic<std::int64_t> worst{ 0 };
+		};
+
+		struct route_hash {
+			using is_transparent = void;
+
+			[[nodiscard]] std::size_t operator()(std::string_view route) const noexcept {
+				return static_cast<std::size_t>(hash_link(route));
+			}
+		};
+
+		// Carved from its own arena, together with the link text and parameter index
+		struct task {
+			dispatcher::entry* entry = nullptr;
+			std::uint64_t sequence = 0;
+			std::chrono::steady_clock::time_point queued{}; // reset once the first step starts
+			query_view params;
+			link_event event;
+		};
+
+		// Ring of task pointers that only grows to the high-water mark
+		class task_queue {
+		public:
+			void push(task* task) {
+				if (count == slots.size()) {
+					grow();
+				}
+				slots[(head + count) % slots.size()] = task;
+				++count;
+			}
+
+			[[nodiscard]] task* pop() noexcept {
+				if (count == 0) {
+					return nullptr;
+				}
+				task* const task = slots[head];
+				head = (head + 1) % slots.size();
+				--count;
+				return task;
+			}
+
+			[[nodiscard]] std::size_t size() const noexcept { return count; }
+			[[nodiscard]] bool empty() const noexcept { return count == 0; }
+
+		private:
+			void grow() {
+				std::vector<task*> larger(slots.empty() ? 16 : slots.size() * 2);
+				for (std::size_t i = 0; i < count; ++i) {
+					larger[i] = slots[(head + i) % slots.size()];
+				}
+				slots.swap(larger);
+				head = 0;
+			}
+
+			std::vector<task*> slots;
+			std::size_t head = 0;
+			std::size_t count = 0;
+		};
+
+		template<typename Handler>
+		static auto one_shot(Handler handler) {
+			return [handler = std::move(handler)](const link_event& event) mutable {
+				handler(event);
+				return step::done;
+			};
+		}
+
+		[[nodiscard]] entry* find(std::string_view route);
+
+		// Runs one step of `task`, returns true if it wants to be resumed
+		bool advance(task& task);
+		void retire(task* task) noexcept;
+		void work(std::stop_token stop);
+
+		std::unordered_map<std::string, entry, route_hash, std::equal_to<>> routes;
+		entry* fallback = nullptr;
+		entry fallback_entry;
+
+		arena_pool memory;
+		dplnk::journal* journal;
+
+		mutable std::mutex mutex;
+		task_queue main;
+		task_queue deferred;
+		task_queue background;
+		std::condition_variable_any wake;
+
+		std::atomic<std::uint64_t> dispatched{ 0 };
+		std::atomic<std::uint64_t> unhandled{ 0 };
+		std::atomic<std::uint64_t> completed{ 0 };
+		std::atomic<std::uint64_t> failed{ 0 };
+
+		std::vector<std::jthread> workers;
+	};
+} // namespace dplnk
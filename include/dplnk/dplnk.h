@@ -1,15 +1,59 @@
 #pragma once
 
+#include <chrono>
+#include <cstddef>
+#include <expected>
 #include <stdexcept>
 #include <optional>
 #include <string>
+#include <system_error>
 #include <map>
+#include <vector>
+
+#include "scheme.h"
 
 namespace dplnk {
 	struct options {
 		std::string protocol;
 		std::optional<std::map<std::string, std::string>> d;
 	};
-	
+
+	// What a registration wrote
+	struct report {
+		// Registry keys and values written, or files replaced
+		std::size_t writes = 0;
+		std::chrono::nanoseconds elapsed{};
+	};
+
+	struct error {
+		// A Win32 status in `std::system_category()` or an errno in `std::generic_category()`
+		std::error_code code;
+		// The step that failed, a string literal such as "RegKey::create command"
+		const char* step = "";
+	};
+
 	void dplnk(const std::string& path, options options);
-} // namespace dplnk
\ No newline at end of file
+
+	// `dplnk` without exceptions: every failure comes back as a value, so it can be called from code built with
+	// -fno-exceptions and a failure costs no unwinding. Only running out of memory still terminates.
+	[[nodiscard]] std::expected<report, error> try_register(const std::string& path, const options& options) noexcept;
+
+	namespace detail {
+		[[nodiscard]] std::expected<report, error> try_register_scheme(const scheme_keys& keys, const std::string& path, const std::optional<std::map<std::string, std::string>>& d) noexcept;
+	} // namespace detail
+
+	template<fixed_string Protocol>
+	[[nodiscard]] std::expected<report, error> try_register(scheme<Protocol>, const std::string& path, const std::optional<std::map<std::string, std::string>>& d = std::nullopt) noexcept {
+		return detail::try_register_scheme(scheme<Protocol>::keys, path, d);
+	}
+
+	// Removes what `dplnk` registered for `protocol`, nothing happens if it is not registered or was registered by
+	// something else (such as the system's `http` handler)
+	void unregister(const std::string& protocol);
+	// Removes all of `protocols` together, rewriting the shared association files once
+	void unregister(const std::vector<std::string>& protocols);
+
+	// Removes every scheme whose registered command starts `path`, such as the ones an uninstalled launcher left behind.
+	// Returns how many were removed.
+	std::size_t unregister_all_for(const std::string& path);
+} // namespace dplnk
@@ -0,0 +1,120 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+namespace dplnk {
+	class dispatcher;
+
+	// Where a link came from, as recorded in the journal
+	enum class link_source : std::uint8_t {
+		api,
+		command_line,
+		forwarded,
+		spool,
+		replay,
+	};
+
+	enum class journal_record : std::uint8_t {
+		received,  // carries the link, every other kind refers back to it by sequence
+		unhandled,
+		completed,
+		failed,
+	};
+
+	struct journal_entry {
+		journal_record kind = journal_record::received;
+		link_source source = link_source::api;
+		std::uint64_t sequence = 0;
+		std::chrono::nanoseconds time{ 0 }; // since the journal was opened
+		std::string link;
+	};
+
+	struct journal_options {
+		// In-memory ring between recording threads and the file, records that do not fit are dropped.
+		// The flusher is woken early once it is half full.
+		std::size_t buffer = 256 * 1024;
+		std::chrono::milliseconds flush_interval{ 50 };
+	};
+
+	struct journal_stats {
+		std::uint64_t recorded = 0;
+		std::uint64_t dropped = 0;
+		std::uint64_t bytes = 0;
+		std::uint64_t batches = 0;
+	};
+
+	// Append-only binary log of received links and their outcomes. Recording is lock free and never
+	// allocates or touches the file; a single flusher thread writes whatever accumulated in one batch.
+	class journal {
+	public:
+		explicit journal(const std::filesystem::path& file, journal_options options = {});
+		~journal();
+
+		journal(const journal&) = delete;
+		journal& operator=(const journal&) = delete;
+
+		// Thread safe. Returns the sequence number outcomes refer back to.
+		std::uint64_t received(std::string_view link, link_source source) noexcept;
+		void outcome(std::uint64_t sequence, journal_record kind) noexcept;
+
+		[[nodiscard]] journal_stats stats() const noexcept;
+		// Set once a batch could not be written (a full disk, say). The journal keeps what it had and stops
+		// there, so it still reads back cleanly; later records count as dropped.
+		[[nodiscard]] std::error_code error() const noexcept;
+
+	private:
+		void record(journal_record kind, link_source source, std::uint64_t sequence, std::string_view link) noexcept;
+		void flush(std::vector<std::byte>& batch);
+		void write();
+
+		std::unique_ptr<std::uint64_t[]> ring;
+		std::size_t capacity;
+		std::chrono::steady_clock::time_point opened;
+
+		alignas(64) std::atomic<std::uint64_t> reserved{ 0 };
+		alignas(64) std::atomic<std::uint64_t> consumed{ 0 };
+		alignas(64) std::atomic<std::uint64_t> sequence{ 0 };
+
+		std::atomic<std::uint64_t> recorded{ 0 };
+		std::atomic<std::uint64_t> dropped{ 0 };
+		std::atomic<std::uint64_t> bytes{ 0 };
+		std::atomic<std::uint64_t> batches{ 0 };
+		std::atomic<int> failure{ 0 };
+
+		std::FILE* file;
+		std::chrono::milliseconds interval;
+
+		std::mutex mutex;
+		std::condition_variable wake;
+		bool stopping = false;
+		std::atomic<bool> hurry{ false };
+		std::thread writer;
+	};
+
+	// Reads back a journal written by `journal`, stopping at the first incomplete record
+	[[nodiscard]] std::vector<journal_entry> read_journal(const std::filesystem::path& file);
+
+	struct replay_options {
+		// 1 keeps the original timing, 10 plays ten times as fast, 0 dispatches back to back
+		double speed = 1.0;
+		// Time slice given to `dispatcher::run` while waiting for the next link
+		std::chrono::microseconds frame_budget{ 1000 };
+	};
+
+	// Feeds the received links of a journal through `dispatcher` as `link_source::replay`, running its
+	// main-thread and deferred handlers until everything replayed has been handled. Returns the links dispatched.
+	std::size_t replay(const std::filesystem::path& file, dispatcher& dispatcher, replay_options options = {});
+} // namespace dplnk
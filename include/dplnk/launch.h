@@ -0,0 +1,14 @@
+#pragma once
+
+#include <string_view>
+
+namespace dplnk {
+	// Opens `url` with the application registered for its scheme, as clicking the link would.
+	// On Linux the handler comes from the shared `scheme_index` and its `Exec` line is started directly with
+	// `posix_spawn`, skipping xdg-open's shell script and desktop detection. xdg-open is only the fallback, when
+	// no handler resolves or it cannot be started. The index is cached, so a default changed by another process
+	// is only seen after `scheme_index::invalidate` (a `registration_watcher` does that). A detached thread waits on
+	// each started process, so none is left behind as a zombie. On Windows it is `ShellExecuteExW`.
+	// Throws std::invalid_argument if `url` has no valid scheme, std::system_error if nothing could be started.
+	void open(std::string_view url);
+} // namespace dplnk
@@ -0,0 +1,110 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string_view>
+
+namespace dplnk {
+	// `mygame://lobby/join?id=1#top` splits into "mygame", "lobby/join", "id=1" and "top"
+	struct link_parts {
+		std::string_view scheme;
+		std::string_view route;
+		std::string_view query;
+		std::string_view fragment;
+	};
+
+	[[nodiscard]] constexpr link_parts split_link(std::string_view link) noexcept {
+		link_parts parts;
+
+		if (const auto colon = link.find(':'); colon != std::string_view::npos) {
+			parts.scheme = link.substr(0, colon);
+			link.remove_prefix(colon + 1);
+		}
+
+		if (const auto hash = link.find('#'); hash != std::string_view::npos) {
+			parts.fragment = link.substr(hash + 1);
+			link = link.substr(0, hash);
+		}
+
+		if (const auto question = link.find('?'); question != std::string_view::npos) {
+			parts.query = link.substr(question + 1);
+			link = link.substr(0, question);
+		}
+
+		// Browsers are inconsistent about `//` and trailing slashes, neither changes the route
+		while (link.starts_with('/')) {
+			link.remove_prefix(1);
+		}
+		while (link.ends_with('/')) {
+			link.remove_suffix(1);
+		}
+
+		parts.route = link;
+		return parts;
+	}
+
+	[[nodiscard]] constexpr std::string_view route_of(std::string_view link) noexcept {
+		return split_link(link).route;
+	}
+
+	// Raw (still percent-encoded) value of the first `key` parameter in `query`
+	[[nodiscard]] constexpr std::optional<std::string_view> find_param(std::string_view query, std::string_view key) noexcept {
+		while (!query.empty()) {
+			const auto amp = query.find('&');
+			const std::string_view pair = query.substr(0, amp);
+			query = amp == std::string_view::npos ? std::string_view{} : query.substr(amp + 1);
+
+			const auto equals = pair.find('=');
+			if (pair.substr(0, equals) == key) {
+				return equals == std::string_view::npos ? std::string_view{} : pair.substr(equals + 1);
+			}
+		}
+
+		return std::nullopt;
+	}
+
+	// Decodes `%XX` escapes into `out`, which needs room for `in.size()` characters.
+	// Returns the decoded length, or nothing on a malformed escape. `+` is left as is (RFC 3986).
+	[[nodiscard]] constexpr std::optional<std::size_t> percent_decode(std::string_view in, char* out) noexcept {
+		constexpr auto hex = [](char c) -> int {
+			if (c >= '0' && c <= '9') return c - '0';
+			if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+			if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+			return -1;
+		};
+
+		std::size_t size = 0;
+		for (std::size_t i = 0; i < in.size(); ++i) {
+			if (in[i] != '%') {
+				out[size++] = in[i];
+				continue;
+			}
+
+			if (in.size() - i < 3) {
+				return std::nullopt;
+			}
+
+			const int high = hex(in[i + 1]);
+			const int low = hex(in[i + 2]);
+			if (high < 0 || low < 0) {
+				return std::nullopt;
+			}
+
+			out[size++] = static_cast<char>(high * 16 + low);
+			i += 2;
+		}
+
+		return size;
+	}
+
+	// 64-bit FNV-1a, stable across processes and builds
+	[[nodiscard]] constexpr std::uint64_t hash_link(std::string_view text) noexcept {
+		std::uint64_t hash = 0xcbf29ce484222325ull;
+		for (const char c : text) {
+			hash ^= static_cast<unsigned char>(c);
+			hash *= 0x100000001b3ull;
+		}
+		return hash;
+	}
+} // namespace dplnk
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstddef>
+#include <map>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace dplnk {
+	// What the system will launch for a scheme
+	struct registration_info {
+		std::string protocol;
+		// The registered command line: `shell\open\command` on Windows, the desktop entry's `Exec` elsewhere
+		std::string command;
+		// The executable the command starts
+		std::string path;
+		std::map<std::string, std::string> d;
+		// The desktop file id on Linux, the HKCR key on Windows
+		std::string handler;
+	};
+
+	// Snapshot of every scheme handler on the system, built in one pass. On Linux it follows the XDG
+	// mime-apps rules: mimeapps.list defaults, added and removed associations across config and data
+	// dirs, then the MimeType of installed desktop files. On Windows it is one enumeration of HKCR.
+	class scheme_index {
+	public:
+		[[nodiscard]] static scheme_index build();
+
+		// The shared index, built on first use and rebuilt after `invalidate`. Thread safe.
+		[[nodiscard]] static std::shared_ptr<const scheme_index> current();
+		static void invalidate() noexcept;
+
+		// Schemes compare case-insensitively, nothing is allocated
+		[[nodiscard]] const registration_info* find(std::string_view protocol) const noexcept;
+
+		[[nodiscard]] std::size_t size() const noexcept { return entries.size(); }
+		[[nodiscard]] auto begin() const noexcept { return entries.begin(); }
+		[[nodiscard]] auto end() const noexcept { return entries.end(); }
+
+	private:
+		struct scheme_hash {
+			using is_transparent = void;
+			[[nodiscard]] std::size_t operator()(std::string_view protocol) const noexcept;
+		};
+
+		struct scheme_equal {
+			using is_transparent = void;
+			[[nodiscard]] bool operator()(std::string_view a, std::string_view b) const noexcept;
+		};
+
+		std::unordered_map<std::string, registration_info, scheme_hash, scheme_equal> entries;
+	};
+
+	// Which application handles `protocol`, from the shared index
+	[[nodiscard]] std::optional<registration_info> query(std::string_view protocol);
+} // namespace dplnk
@@ -0,0 +1,163 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <string_view>
+#include <utility>
+
+namespace dplnk {
+	class histogram;
+
+	struct histogram_snapshot {
+		static constexpr std::size_t buckets = 304;
+
+		std::array<std::uint64_t, buckets> counts{};
+		std::uint64_t count = 0;
+		std::chrono::nanoseconds sum{ 0 };
+		std::chrono::nanoseconds min{ 0 };
+		std::chrono::nanoseconds max{ 0 };
+
+		[[nodiscard]] std::chrono::nanoseconds mean() const noexcept;
+		// Upper bound of the bucket holding quantile `q` (0 to 1), within 12.5% of the true value
+		[[nodiscard]] std::chrono::nanoseconds percentile(double q) const noexcept;
+	};
+
+	namespace detail {
+		// Written only by the thread that claimed it, so updates are plain loads and stores
+		struct alignas(64) histogram_shard {
+			std::array<std::atomic<std::uint64_t>, histogram_snapshot::buckets> counts{};
+			std::atomic<std::uint64_t> sum{ 0 };
+			std::atomic<std::uint64_t> max{ 0 };
+			std::atomic<std::uint64_t> min{ (std::numeric_limits<std::uint64_t>::max)() };
+
+			std::atomic<bool> claimed{ false };
+		};
+
+		// The shards a thread owns, by histogram id; handed back for reuse when the thread exits.
+		// A null shard means every slot was taken and the thread records into the shared one.
+		struct thread_shards {
+			static constexpr std::size_t capacity = 16;
+
+			std::array<std::pair<std::uint64_t, histogram_shard*>, capacity> owned{};
+			std::size_t count = 0;
+
+			~thread_shards();
+		};
+
+		inline thread_local thread_shards local_shards;
+	} // namespace detail
+
+	// Log-bucketed latency histogram: eight linear sub-buckets per power of two of nanoseconds, up to
+	// about 18 minutes. Each of the first `shards` threads to record claims a preallocated shard of its
+	// own and records with a handful of relaxed loads and stores, no read-modify-write; later threads
+	// share one shard through relaxed atomic adds. Recording never allocates. Shards are merged when a
+	// snapshot is taken.
+	class histogram {
+	public:
+		static constexpr std::size_t buckets = histogram_snapshot::buckets;
+		static constexpr std::size_t shards = 16;
+
+		histogram();
+		~histogram();
+
+		histogram(const histogram&) = delete;
+		histogram& operator=(const histogram&) = delete;
+
+		[[nodiscard]] static constexpr std::size_t bucket_of(std::uint64_t nanoseconds) noexcept {
+			if (nanoseconds < 8) {
+				return static_cast<std::size_t>(nanoseconds);
+			}
+
+			const auto exponent = static_cast<std::size_t>(std::bit_width(nanoseconds) - 1);
+			if (exponent >= 40) {
+				return buckets - 1;
+			}
+			return (exponent - 2) * 8 + static_cast<std::size_t>((nanoseconds >> (exponent - 3)) & 7);
+		}
+
+		[[nodiscard]] static constexpr std::uint64_t bucket_floor(std::size_t bucket) noexcept {
+			if (bucket < 8) {
+				return bucket;
+			}
+			return (8 + bucket % 8) << (bucket / 8 - 1);
+		}
+
+		void record(std::chrono::nanoseconds elapsed) noexcept {
+			const std::uint64_t value = elapsed.count() > 0 ? static_cast<std::uint64_t>(elapsed.count()) : 0;
+			detail::histogram_shard* const shard = local();
+			if (shard == nullptr) {
+				record_shared(value);
+				return;
+			}
+
+			auto& count = shard->counts[bucket_of(value)];
+			count.store(count.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+			shard->sum.store(shard->sum.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+
+			if (value > shard->max.load(std::memory_order_relaxed)) {
+				shard->max.store(value, std::memory_order_relaxed);
+			}
+			if (value < shard->min.load(std::memory_order_relaxed)) {
+				shard->min.store(value, std::memory_order_relaxed);
+			}
+		}
+
+		[[nodiscard]] histogram_snapshot snapshot() const noexcept;
+		// Samples recorded while this runs may be lost
+		void reset() noexcept;
+
+	private:
+		// The calling thread's shard, nothing if it records into `shared`
+		[[nodiscard]] detail::histogram_shard* local() noexcept {
+			const auto& cache = detail::local_shards;
+			for (std::size_t i = 0; i < cache.count; ++i) {
+				if (cache.owned[i].first == id) {
+					return cache.owned[i].second;
+				}
+			}
+			return claim();
+		}
+
+		[[nodiscard]] detail::histogram_shard* claim() noexcept;
+		void record_shared(std::uint64_t value) noexcept;
+
+		std::uint64_t id;
+		std::array<detail::histogram_shard, shards> owned{};
+		// For threads past the first `shards`, updated with atomic adds
+		detail::histogram_shard shared;
+	};
+
+	// What the library itself measures
+	enum class metric {
+		registration, // writing a scheme registration
+		forward,      // handing a link to a running or future instance
+		queue,        // from `dispatcher::dispatch` to the first step of its handler
+		handler,      // a single handler step
+	};
+
+	[[nodiscard]] histogram& latency(metric metric) noexcept;
+
+	// Every `metric` as a Prometheus summary, in seconds
+	[[nodiscard]] std::string export_metrics();
+
+	// Records the time until it goes out of scope
+	class scoped_latency {
+	public:
+		explicit scoped_latency(histogram& histogram) noexcept : target{ histogram }, start{ std::chrono::steady_clock::now() } {}
+		explicit scoped_latency(metric metric) noexcept : scoped_latency{ latency(metric) } {}
+		~scoped_latency() { target.record(std::chrono::steady_clock::now() - start); }
+
+		scoped_latency(const scoped_latency&) = delete;
+		scoped_latency& operator=(const scoped_latency&) = delete;
+
+	private:
+		histogram& target;
+		std::chrono::steady_clock::time_point start;
+	};
+} // namespace dplnk
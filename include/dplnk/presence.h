@@ -0,0 +1,58 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+
+namespace dplnk {
+	struct instance {
+		std::uint32_t pid = 0;
+		std::uint64_t start_time = 0;
+		std::chrono::steady_clock::time_point heartbeat{};
+
+		char endpoint_data[120]{};
+		std::size_t endpoint_size = 0;
+
+		[[nodiscard]] std::string_view endpoint() const noexcept { return { endpoint_data, endpoint_size }; }
+	};
+
+	namespace detail {
+		struct presence_layout;
+	} // namespace detail
+
+	// A small shared-memory table of the running instances for a scheme, named after the protocol.
+	// Every slot is guarded by a seqlock, so readers never block writers and a forwarder can tell
+	// whether to forward or launch from one read of the mapping, without probing sockets or files.
+	class presence_table {
+	public:
+		static constexpr std::size_t slots = 8;
+
+		explicit presence_table(std::string_view protocol);
+		~presence_table();
+
+		presence_table(const presence_table&) = delete;
+		presence_table& operator=(const presence_table&) = delete;
+
+		// Claims a slot for the calling process, reusing slots of crashed processes. Returns false if the table is full.
+		bool announce(std::string_view endpoint);
+
+		// Call periodically (well within `find_live`'s `max_silence`) while the instance can accept links
+		void heartbeat() noexcept;
+		void withdraw() noexcept;
+
+		// The first instance with a recent heartbeat whose pid still belongs to the process that announced it
+		[[nodiscard]] std::optional<instance> find_live(std::chrono::milliseconds max_silence = std::chrono::seconds{ 5 }) const noexcept;
+
+	private:
+		[[nodiscard]] bool read(std::size_t slot, instance& out) const noexcept;
+
+		detail::presence_layout* table = nullptr;
+		std::intptr_t handle = -1;
+		std::size_t claimed = slots;
+		// This process as a slot writer, see `presence_slot::writer`
+		std::uint64_t owner = 0;
+	};
+} // namespace dplnk
@@ -0,0 +1,122 @@
+#pragma once
+
+#include "link.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+
+namespace dplnk {
+	namespace detail {
+		struct query_index {
+			std::uint16_t* key_offsets;
+			std::uint16_t* key_lengths;
+			std::uint16_t* value_offsets;
+			std::uint16_t* value_lengths;
+			std::size_t capacity;
+		};
+
+		struct query_index_result {
+			std::size_t count = 0;
+			bool truncated = false;
+		};
+
+		// Records the key and value spans of every `key=value` pair in `query` in one pass
+		query_index_result index_query(std::string_view query, const query_index& index) noexcept;
+	} // namespace detail
+
+	// Indexes a query string once, then looks parameters up by key. Offsets are kept inline as a
+	// structure of arrays for up to `N` parameters and nothing is decoded until a value is read.
+	template<std::size_t N = 16>
+	class basic_query_view {
+	public:
+		static_assert(N > 0, "dplnk::basic_query_view needs room for at least one parameter");
+
+		basic_query_view() noexcept = default;
+
+		explicit basic_query_view(std::string_view query) noexcept : text{ query } {
+			const auto result = detail::index_query(query, { key_offsets, key_lengths, value_offsets, value_lengths, N });
+			count = result.count;
+			overflow = result.truncated;
+		}
+
+		[[nodiscard]] static basic_query_view from_link(std::string_view link) noexcept {
+			return basic_query_view{ split_link(link).query };
+		}
+
+		[[nodiscard]] std::size_t size() const noexcept { return count; }
+		[[nodiscard]] bool empty() const noexcept { return count == 0; }
+
+		// More parameters than fit in `N` (or past the first 64 KiB); only the first ones are indexed
+		[[nodiscard]] bool truncated() const noexcept { return overflow; }
+
+		[[nodiscard]] std::string_view key(std::size_t i) const noexcept { return text.substr(key_offsets[i], key_lengths[i]); }
+		[[nodiscard]] std::string_view raw(std::size_t i) const noexcept { return text.substr(value_offsets[i], value_lengths[i]); }
+
+		[[nodiscard]] bool contains(std::string_view key) const noexcept { return find(key) != npos; }
+
+		// The still percent-encoded value of the first parameter named `key`
+		[[nodiscard]] std::optional<std::string_view> raw(std::string_view key) const noexcept {
+			const std::size_t i = find(key);
+			return i == npos ? std::nullopt : std::optional{ raw(i) };
+		}
+
+		// Percent-decodes the value into `buffer` only if it needs decoding, otherwise returns the raw view
+		[[nodiscard]] std::optional<std::string_view> value(std::string_view key, std::span<char> buffer) const noexcept {
+			const auto encoded = raw(key);
+			if (!encoded || encoded->find('%') == std::string_view::npos) {
+				return encoded;
+			}
+
+			if (buffer.size() < encoded->size()) {
+				return std::nullopt;
+			}
+
+			const auto size = percent_decode(*encoded, buffer.data());
+			return size ? std::optional{ std::string_view{ buffer.data(), *size } } : std::nullopt;
+		}
+
+		[[nodiscard]] std::optional<std::string> decoded(std::string_view key) const {
+			const auto encoded = raw(key);
+			if (!encoded) {
+				return std::nullopt;
+			}
+
+			std::string result(encoded->size(), '\0');
+			const auto size = percent_decode(*encoded, result.data());
+			if (!size) {
+				return std::nullopt;
+			}
+
+			result.resize(*size);
+			return result;
+		}
+
+	private:
+		static constexpr std::size_t npos = static_cast<std::size_t>(-1);
+
+		[[nodiscard]] std::size_t find(std::string_view key) const noexcept {
+			// Lengths first: they sit in one contiguous array and reject almost every candidate
+			for (std::size_t i = 0; i < count; ++i) {
+				if (key_lengths[i] == key.size() && this->key(i) == key) {
+					return i;
+				}
+			}
+			return npos;
+		}
+
+		std::string_view text;
+		std::size_t count = 0;
+		bool overflow = false;
+
+		std::uint16_t key_lengths[N]{};
+		std::uint16_t key_offsets[N]{};
+		std::uint16_t value_offsets[N]{};
+		std::uint16_t value_lengths[N]{};
+	};
+
+	using query_view = basic_query_view<>;
+} // namespace dplnk
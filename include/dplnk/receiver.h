@@ -0,0 +1,127 @@
+#pragma once
+
+#include "link.h"
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace dplnk {
+	// What happens to a link that arrives while the queue is full
+	enum class overflow_policy {
+		drop_oldest, // evict the oldest queued link
+		drop_newest, // reject the incoming link
+		coalesce,    // replace the newest queued link for the same route, else drop the oldest
+	};
+
+	enum class push_result {
+		queued,
+		coalesced,
+		duplicate,
+		rate_limited,
+		dropped,
+	};
+
+	struct receiver_options {
+		std::size_t capacity = 64;
+		overflow_policy overflow = overflow_policy::drop_oldest;
+
+		// Identical links seen again within this window are ignored, zero disables deduplication
+		std::chrono::milliseconds dedupe_window{ 1000 };
+		std::size_t dedupe_slots = 64;
+
+		// Token bucket per route, a rate of zero disables rate limiting
+		double route_rate = 4.0;
+		double route_burst = 8.0;
+		std::size_t route_slots = 64;
+
+		// One bucket every link is also charged against. Route buckets live in a fixed table and a route that lost
+		// its slot starts over with a full burst, so without this cycling through many routes would never be limited.
+		double total_rate = 16.0;
+		double total_burst = 32.0;
+	};
+
+	struct receiver_stats {
+		std::uint64_t received = 0;
+		std::uint64_t queued = 0;
+		std::uint64_t coalesced = 0;
+		std::uint64_t duplicates = 0;
+		std::uint64_t rate_limited = 0;
+		std::uint64_t dropped = 0;
+		std::uint64_t evicted = 0;
+	};
+
+	// Bounded queue of incoming links with deduplication, per-route rate limiting and backpressure.
+	// Any thread may push, a single thread polls. Every push is O(1) and, once each queue slot
+	// has held a link of similar length, allocation free.
+	class receiver {
+	public:
+		using clock = std::chrono::steady_clock;
+
+		explicit receiver(receiver_options options = {});
+
+		push_result push(std::string_view link);
+		push_result push(std::string_view link, clock::time_point now);
+
+		// Moves the oldest queued link into `link`, returns false if the queue is empty
+		bool pop(std::string& link);
+
+		// Hands queued links to `handler(std::string_view)` without holding the queue lock
+		template<typename Handler>
+		std::size_t poll(Handler&& handler, std::size_t max = (std::numeric_limits<std::size_t>::max)()) {
+			std::size_t count = 0;
+			while (count < max && pop(scratch)) {
+				handler(std::string_view{ scratch });
+				++count;
+			}
+			return count;
+		}
+
+		[[nodiscard]] std::size_t size() const;
+		[[nodiscard]] std::size_t capacity() const noexcept { return queue.size(); }
+		[[nodiscard]] receiver_stats stats() const;
+
+	private:
+		struct slot {
+			std::string link;
+			std::uint64_t route = 0;
+		};
+
+		struct seen {
+			std::uint64_t hash = 0;
+			clock::time_point at{};
+		};
+
+		struct bucket {
+			std::uint64_t route = 0;
+			double tokens = 0.0;
+			clock::time_point refilled{};
+			std::uint64_t newest = 0; // sequence number of the newest queued link + 1, zero if none
+		};
+
+		[[nodiscard]] bool is_duplicate(std::uint64_t hash, clock::time_point now) const;
+		// Only accepted links are remembered, so a rejected one can be retried
+		void remember(std::uint64_t hash, clock::time_point now);
+		bool take_tokens(bucket& route, clock::time_point now);
+		void enqueue(std::string_view link, std::uint64_t route, bucket& bucket);
+
+		receiver_options options;
+
+		mutable std::mutex mutex;
+		std::vector<slot> queue;
+		std::uint64_t head = 0;
+		std::uint64_t tail = 0;
+
+		std::vector<seen> recent;
+		std::vector<bucket> routes;
+		bucket total;
+
+		receiver_stats counters;
+		std::string scratch;
+	};
+} // namespace dplnk
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <map>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace dplnk {
+	template<std::size_t N>
+	struct fixed_string {
+		char value[N]{};
+
+		constexpr fixed_string(const char (&str)[N]) noexcept {
+			std::copy_n(str, N, value);
+		}
+
+		[[nodiscard]] constexpr std::size_t size() const noexcept { return N - 1; }
+		[[nodiscard]] constexpr std::string_view view() const noexcept { return { value, N - 1 }; }
+	};
+
+	// RFC 3986 section 3.1: scheme = ALPHA *( ALPHA / DIGIT / "+" / "-" / "." )
+	[[nodiscard]] constexpr bool is_valid_scheme(std::string_view protocol) noexcept {
+		constexpr auto alpha = [](char c) { return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z'); };
+		constexpr auto digit = [](char c) { return c >= '0' && c <= '9'; };
+
+		if (protocol.empty() || !alpha(protocol.front())) {
+			return false;
+		}
+
+		return std::all_of(protocol.begin() + 1, protocol.end(), [&](char c) {
+			return alpha(c) || digit(c) || c == '+' || c == '-' || c == '.';
+		});
+	}
+
+	namespace detail {
+		template<std::size_t N>
+		struct wide_string {
+			wchar_t value[N]{};
+
+			[[nodiscard]] constexpr std::wstring_view view() const noexcept { return { value, N - 1 }; }
+		};
+
+		template<std::size_t... Ns>
+		[[nodiscard]] constexpr auto widen(const char (&... parts)[Ns]) noexcept {
+			wide_string<(Ns + ...) - sizeof...(Ns) + 1> result;
+
+			std::size_t at = 0;
+			([&] {
+				for (std::size_t i = 0; i + 1 < Ns; ++i) {
+					result.value[at++] = static_cast<wchar_t>(parts[i]);
+				}
+			}(), ...);
+
+			return result;
+		}
+
+		// Every registry key path and value a scheme registration touches
+		struct scheme_keys {
+			std::wstring_view key;
+			std::wstring_view icon_key;
+			std::wstring_view command_key;
+			std::wstring_view description;
+		};
+
+		void register_scheme(const scheme_keys& keys, const std::string& path, const std::optional<std::map<std::string, std::string>>& d);
+
+		// Removes all of `protocols` at once, so the shared association files are rewritten only once
+		void unregister_schemes(const std::vector<std::string>& protocols);
+	} // namespace detail
+
+	template<fixed_string Protocol>
+	struct scheme {
+		static_assert(is_valid_scheme(Protocol.view()), "dplnk::scheme: protocol is not a valid RFC 3986 scheme");
+
+		static constexpr std::string_view protocol = Protocol.view();
+
+		static constexpr auto key = detail::widen(Protocol.value);
+		static constexpr auto icon_key = detail::widen(Protocol.value, "\\DefaultIcon");
+		static constexpr auto command_key = detail::widen(Protocol.value, "\\shell\\open\\command");
+		static constexpr auto description = detail::widen("URL: ", Protocol.value, " Protocol");
+
+		static constexpr detail::scheme_keys keys{ key.view(), icon_key.view(), command_key.view(), description.view() };
+	};
+
+	template<fixed_string Protocol>
+	void dplnk(scheme<Protocol>, const std::string& path, const std::optional<std::map<std::string, std::string>>& d = std::nullopt) {
+		detail::register_scheme(scheme<Protocol>::keys, path, d);
+	}
+} // namespace dplnk
@@ -0,0 +1,83 @@
+#pragma once
+
+#include "receiver.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <mutex>
+#include <string_view>
+
+namespace dplnk {
+	namespace detail {
+		struct spool_header;
+	} // namespace detail
+
+	struct spool_options {
+		// Size of the spool file when it is created, an existing file keeps its size
+		std::size_t capacity = 256 * 1024;
+		// Overrides `link_spool::default_path`
+		std::filesystem::path file;
+	};
+
+	struct spool_stats {
+		std::uint64_t appended = 0;
+		std::uint64_t drained = 0;
+		std::uint64_t rejected = 0; // did not fit even after compaction
+		std::uint64_t corrupt = 0;  // records dropped for a checksum mismatch
+		std::uint64_t compactions = 0;
+	};
+
+	// Crash-safe, append-only log of pending links in a memory-mapped file, shared by every process
+	// of the user. Records carry a checksum and are terminated, so a torn write loses at most the
+	// record being written. Consumed space is reclaimed when the spool drains or runs out of room.
+	class link_spool {
+	public:
+		explicit link_spool(std::string_view protocol, spool_options options = {});
+		~link_spool();
+
+		link_spool(const link_spool&) = delete;
+		link_spool& operator=(const link_spool&) = delete;
+
+		// With `durable`, returns only once the record has reached the disk. False if the spool is full.
+		bool append(std::string_view link, bool durable = true);
+
+		// Pushes pending links into `receiver`, to be handed out by its `poll`, and returns how many it queued.
+		// Stops once the receiver is full or rate limits a link; what is left stays in the spool for the next drain,
+		// so a startup backlog is delivered over a few frames instead of lost. Delivery is at least once:
+		// links drained right before a crash may be drained again, which the receiver's deduplication absorbs.
+		std::size_t drain(receiver& receiver);
+
+		// Two loads from the mapping, cheap enough to check every frame
+		[[nodiscard]] bool empty() const noexcept;
+		[[nodiscard]] spool_stats stats() const;
+
+		// The per-user spool of a scheme, `%LOCALAPPDATA%\dplnk` on Windows, `$XDG_STATE_HOME/dplnk` elsewhere
+		[[nodiscard]] static std::filesystem::path default_path(std::string_view protocol);
+
+	private:
+		void close() noexcept;
+		void recover();
+		bool compact(bool durable);
+		void sync(std::size_t offset, std::size_t size) const noexcept;
+
+		detail::spool_header* header = nullptr;
+		std::byte* data = nullptr; // the whole mapping, `header` included
+		std::size_t size = 0;
+
+		std::intptr_t file = -1;
+		std::intptr_t mapping = -1;
+
+		mutable std::mutex mutex;
+		spool_stats counters;
+	};
+
+	enum class forward_result {
+		forwarded, // a live instance is announced and will drain the link, nothing was synced
+		spooled,   // no live instance, the link was synced to disk for the next launch to pick up
+		dropped,   // the spool is full
+	};
+
+	// Hands `link` to the running instance of `protocol`, or keeps it for the next one to start
+	forward_result forward(std::string_view protocol, std::string_view link);
+} // namespace dplnk
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+namespace dplnk {
+	namespace detail {
+		enum class trace_phase : std::uint8_t {
+			complete,   // a span with a duration
+			flow_begin, // a link leaving this process
+			flow_end,   // a link arriving in this process
+		};
+
+		// `name` must be a string literal, only the pointer is kept
+		void trace(trace_phase phase, const char* name, std::uint64_t link, std::chrono::steady_clock::time_point start, std::chrono::steady_clock::time_point end) noexcept;
+
+		class trace_span {
+		public:
+			explicit trace_span(const char* name, std::uint64_t link = 0) noexcept : name{ name }, link{ link }, start{ std::chrono::steady_clock::now() } {}
+			~trace_span() { trace(trace_phase::complete, name, link, start, std::chrono::steady_clock::now()); }
+
+			trace_span(const trace_span&) = delete;
+			trace_span& operator=(const trace_span&) = delete;
+
+		private:
+			const char* name;
+			std::uint64_t link;
+			std::chrono::steady_clock::time_point start;
+		};
+	} // namespace detail
+
+	// The spans still held in the ring (the newest 8192), as Chrome trace-event JSON for chrome://tracing or Perfetto.
+	// Timestamps come from the system-wide monotonic clock, so traces exported by the forwarder and by the receiving
+	// process can be merged into one timeline, where flow arrows join them by link id (`hash_link`).
+	// Without DPLNK_ENABLE_TRACING it is always an empty trace, and the ring is never allocated.
+	[[nodiscard]] std::string export_trace();
+	void clear_trace() noexcept;
+} // namespace dplnk
+
+#define DPLNK_TRACE_CONCAT_INNER(a, b) a##b
+#define DPLNK_TRACE_CONCAT(a, b) DPLNK_TRACE_CONCAT_INNER(a, b)
+
+// Enabled with the DPLNK_ENABLE_TRACING CMake option, otherwise the macros and their arguments compile away
+#ifdef DPLNK_ENABLE_TRACING
+#define DPLNK_TRACE_SPAN(name) const ::dplnk::detail::trace_span DPLNK_TRACE_CONCAT(dplnk_trace_span_, __LINE__){ name }
+#define DPLNK_TRACE_LINK_SPAN(name, link) const ::dplnk::detail::trace_span DPLNK_TRACE_CONCAT(dplnk_trace_span_, __LINE__){ name, link }
+#define DPLNK_TRACE_INTERVAL(name, link, start, end) ::dplnk::detail::trace(::dplnk::detail::trace_phase::complete, name, link, start, end)
+#define DPLNK_TRACE_FLOW_BEGIN(name, link) ::dplnk::detail::trace(::dplnk::detail::trace_phase::flow_begin, name, link, std::chrono::steady_clock::now(), {})
+#define DPLNK_TRACE_FLOW_END(name, link) ::dplnk::detail::trace(::dplnk::detail::trace_phase::flow_end, name, link, std::chrono::steady_clock::now(), {})
+#else
+#define DPLNK_TRACE_SPAN(name) ((void)0)
+#define DPLNK_TRACE_LINK_SPAN(name, link) ((void)0)
+#define DPLNK_TRACE_INTERVAL(name, link, start, end) ((void)0)
+#define DPLNK_TRACE_FLOW_BEGIN(name, link) ((void)0)
+#define DPLNK_TRACE_FLOW_END(name, link) ((void)0)
+#endif
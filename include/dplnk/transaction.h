@@ -0,0 +1,48 @@
+#pragma once
+
+#include "dplnk.h"
+
+#include <cstddef>
+#include <expected>
+#include <map>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace dplnk {
+	// Registers many schemes as one unit, replacing the shared association files once for all of them. On Linux every
+	// desktop file, mimeapps.list and mimeinfo.cache is staged next to its target with writeback started right away,
+	// then each staged file is synced (`fdatasync`), the files are renamed into place and each directory is synced,
+	// restoring the previous files if a rename fails. That is one sync per file plus one per directory; their writes
+	// overlap, but it is not a single sync. Only these files are flushed, not the rest of the filesystem. On Windows
+	// the registry writes are grouped and end with a single `flushKey`, and the schemes it created are deleted again
+	// if a write fails.
+	class registration_transaction {
+	public:
+		// Nothing touches the system before `commit`, dropping an uncommitted transaction discards it
+		void add(const std::string& path, options options);
+
+		template<fixed_string Protocol>
+		void add(scheme<Protocol>, const std::string& path, std::optional<std::map<std::string, std::string>> d = std::nullopt) {
+			add(path, { std::string{ scheme<Protocol>::protocol }, std::move(d) });
+		}
+
+		// Applies every staged registration or none of them, then empties the transaction
+		void commit();
+		// `commit` without exceptions, a failure leaves the transaction as it was
+		[[nodiscard]] std::expected<report, error> try_commit() noexcept;
+
+		[[nodiscard]] std::size_t size() const noexcept { return entries.size(); }
+
+	private:
+		// Stages its already validated scheme directly, `add` could throw
+		friend std::expected<report, error> detail::try_register_scheme(const detail::scheme_keys& keys, const std::string& path, const std::optional<std::map<std::string, std::string>>& d) noexcept;
+
+		struct entry {
+			std::string path;
+			dplnk::options options;
+		};
+
+		std::vector<entry> entries;
+	};
+} // namespace dplnk
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <optional>
+#include <string>
+
+namespace dplnk {
+	struct watch_options {
+		// When set, `path` is registered again whenever a change leaves the scheme with another handler (or none)
+		std::optional<std::string> reassert;
+		std::optional<std::map<std::string, std::string>> d;
+		// Bursts of changes, such as a package manager installing many desktop files, cost one rebuild
+		std::chrono::milliseconds settle{ 200 };
+		// Invoked on the watcher thread after the scheme index was invalidated
+		std::function<void()> on_change;
+	};
+
+	namespace detail {
+		struct watch_state;
+	} // namespace detail
+
+	// Keeps the scheme index (and optionally our registration) current without polling or re-verifying on
+	// every launch: inotify on the XDG applications dirs and mimeapps.list on Linux, `RegNotifyChangeKeyValue`
+	// on the protocol key on Windows. The thread sleeps in the kernel until something changes.
+	class registration_watcher {
+	public:
+		explicit registration_watcher(std::string protocol, watch_options options = {});
+		~registration_watcher();
+
+		registration_watcher(const registration_watcher&) = delete;
+		registration_watcher& operator=(const registration_watcher&) = delete;
+
+		// Settled bursts of changes seen so far
+		[[nodiscard]] std::uint64_t changes() const noexcept;
+		// Times the registration was found taken over and written again
+		[[nodiscard]] std::uint64_t reassertions() const noexcept;
+
+	private:
+		std::unique_ptr<detail::watch_state> state;
+	};
+} // namespace dplnk
@@ -0,0 +1,111 @@
+﻿#include "arena.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace {
+    constexpr std::size_t block_alignment = alignof(std::max_align_t);
+} // namespace
+
+dplnk::arena::arena(std::size_t capacity, std::pmr::memory_resource* upstream)
+    : upstream{ upstream }, block{ static_cast<std::byte*>(upstream->allocate(capacity, block_alignment)) }, size{ capacity } {
+    spills.reserve(4);
+}
+
+dplnk::arena::~arena() {
+    reset();
+    upstream->deallocate(block, size, block_alignment);
+}
+
+void dplnk::arena::reset() noexcept {
+    for (const auto& spill : spills) {
+        upstream->deallocate(spill.p, spill.bytes, spill.alignment);
+    }
+    spills.clear();
+    offset = 0;
+}
+
+std::string_view dplnk::arena::copy(std::string_view text) {
+    if (text.empty()) {
+        return {};
+    }
+
+    auto* const p = static_cast<char*>(allocate(text.size(), 1));
+    std::memcpy(p, text.data(), text.size());
+    return { p, text.size() };
+}
+
+void* dplnk::arena::do_allocate(std::size_t bytes, std::size_t alignment) {
+    const std::size_t aligned = (offset + alignment - 1) & ~(alignment - 1);
+    if (aligned <= size && bytes <= size - aligned) {
+        offset = aligned + bytes;
+        return block + aligned;
+    }
+
+    void* const p = upstream->allocate(bytes, alignment);
+    try {
+        spills.push_back({ p, bytes, alignment });
+    } catch (...) {
+        upstream->deallocate(p, bytes, alignment);
+        throw;
+    }
+    ++spilled;
+    return p;
+}
+
+void dplnk::arena::do_deallocate(void*, std::size_t, std::size_t) {}
+
+bool dplnk::arena::do_is_equal(const std::pmr::memory_resource& other) const noexcept {
+    return this == &other;
+}
+
+dplnk::arena_pool::arena_pool(dplnk::arena_pool_options options) : options{ options } {
+    owned.reserve(options.max_arenas);
+    available.reserve(options.max_arenas);
+
+    for (std::size_t i = 0; i < std::min(options.preallocate, options.max_arenas); ++i) {
+        owned.push_back(std::make_unique<arena>(options.arena_size));
+        available.push_back(owned.back().get());
+    }
+}
+
+dplnk::arena* dplnk::arena_pool::acquire() {
+    {
+        std::lock_guard lock{ mutex };
+        if (!available.empty()) {
+            arena* const arena = available.back();
+            available.pop_back();
+            return arena;
+        }
+
+        if (owned.size() < options.max_arenas) {
+            owned.push_back(std::make_unique<arena>(options.arena_size));
+            return owned.back().get();
+        }
+    }
+
+    // Over budget: a transient arena that `release` frees instead of keeping
+    return new arena{ options.arena_size };
+}
+
+void dplnk::arena_pool::release(dplnk::arena* arena) noexcept {
+    arena->reset();
+
+    std::lock_guard lock{ mutex };
+    const bool pooled = std::any_of(owned.begin(), owned.end(), [&](const auto& owned) { return owned.get() == arena; });
+    if (pooled) {
+        available.push_back(arena);
+    } else {
+        delete arena;
+    }
+}
+
+std::size_t dplnk::arena_pool::idle() const {
+    std::lock_guard lock{ mutex };
+    return available.size();
+}
+
+std::size_t dplnk::arena_pool::footprint() const {
+    std::lock_guard lock{ mutex };
+    return owned.size() * options.arena_size;
+}
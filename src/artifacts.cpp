@@ -0,0 +1,56 @@
+﻿#include "artifacts.h"
+
+#include "scheme.hpp"
+#include "xdg.hpp"
+
+namespace {
+    // A quoted .reg string: backslashes and quotes are escaped, everything else is literal
+    std::string reg_string(std::string_view value) {
+        std::string quoted = "\"";
+        for (const char c : value) {
+            if (c == '\\' || c == '"') {
+                quoted += '\\';
+            }
+            quoted += c;
+        }
+        return quoted += '"';
+    }
+} // namespace
+
+dplnk::registration_artifacts dplnk::generate_registration(const std::string& path, const dplnk::options& options) {
+    if (!is_valid_scheme(options.protocol)) {
+        throw std::invalid_argument("Invalid protocol: '" + options.protocol + "' is not a valid URL scheme");
+    }
+
+    const std::string description = "URL: " + options.protocol + " Protocol";
+    const std::string key = "HKEY_CLASSES_ROOT\\" + options.protocol;
+
+    registration_artifacts artifacts;
+
+    // The keys and values `register_scheme` creates, in the same order
+    artifacts.reg = "Windows Registry Editor Version 5.00\r\n\r\n"
+        "[" + key + "]\r\n"
+        "@=" + reg_string(description) + "\r\n"
+        "\"URL Protocol\"=\"\"\r\n\r\n"
+        "[" + key + "\\DefaultIcon]\r\n"
+        "@=" + reg_string("C:\\Windows\\System32\\url.dll,0") + "\r\n\r\n"
+        "[" + key + "\\shell\\open\\command]\r\n"
+        "@=" + reg_string("\"" + path + "\" %1") + "\r\n";
+
+    if (options.d.has_value()) {
+        for (const auto& [name, value] : *options.d) {
+            artifacts.reg += reg_string(name) + "=" + reg_string(value) + "\r\n";
+        }
+    }
+
+    const std::string protocol = detail::canonical_scheme(options.protocol);
+    const std::string mime = detail::xdg::scheme_mime(protocol);
+
+    artifacts.desktop_file_name = detail::xdg::desktop_id(protocol);
+    artifacts.desktop_file = detail::xdg::desktop_file(protocol, description, path, options.d);
+
+    artifacts.mimeapps = "[Default Applications]\n" + mime + "=" + artifacts.desktop_file_name + ";\n\n"
+        "[Added Associations]\n" + mime + "=" + artifacts.desktop_file_name + ";\n";
+
+    return artifacts;
+}
@@ -0,0 +1,175 @@
+﻿#include "async.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+
+#ifdef _WIN32 // Windows
+#include <Windows.h>
+#elif defined(__linux__) // Linux
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace dplnk::detail {
+    struct registration_state {
+        std::atomic<registration_status> status{ registration_status::pending };
+        std::exception_ptr failure;
+
+        std::mutex mutex;
+        std::condition_variable settled;
+    };
+} // namespace dplnk::detail
+
+namespace {
+    // Each `notify_idle` starts a new epoch and releases the registrations deferred before it. Workers hold the gate
+    // through a `shared_ptr`, so a detached one still waiting at exit never touches a destroyed static.
+    struct idle_gate {
+        std::mutex mutex;
+        std::condition_variable signal;
+        std::uint64_t epoch = 0;
+    };
+
+    const std::shared_ptr<idle_gate>& gate() {
+        static const auto shared = std::make_shared<idle_gate>();
+        return shared;
+    }
+
+    void lower_thread_priority() noexcept {
+#ifdef _WIN32 // Windows
+        // Background mode also lowers I/O and memory priority, which is what the registry writes contend on
+        SetThreadPriority(GetCurrentThread(), THREAD_MODE_BACKGROUND_BEGIN);
+#elif defined(__linux__) // Linux
+        setpriority(PRIO_PROCESS, static_cast<id_t>(syscall(SYS_gettid)), 19);
+#endif
+    }
+
+    void settle(dplnk::detail::registration_state& state, dplnk::registration_status status, const dplnk::async_options& async) {
+        {
+            std::lock_guard lock{ state.mutex };
+            state.status.store(status, std::memory_order_release);
+        }
+        state.settled.notify_all();
+
+        if (async.on_complete) {
+            try {
+                async.on_complete(status);
+            } catch (...) {
+                // Nothing sensible to report to on a detached thread
+            }
+        }
+    }
+
+    void run(std::shared_ptr<dplnk::detail::registration_state> state, std::string path, dplnk::options options, dplnk::async_options async, std::shared_ptr<idle_gate> idle, std::uint64_t epoch) {
+        lower_thread_priority();
+
+        if (async.policy == dplnk::launch_policy::until_idle) {
+            std::unique_lock lock{ idle->mutex };
+            idle->signal.wait_for(lock, async.idle_timeout, [&] {
+                return idle->epoch != epoch || state->status.load(std::memory_order_acquire) == dplnk::registration_status::cancelled;
+            });
+        }
+
+        auto expected = dplnk::registration_status::pending;
+        if (!state->status.compare_exchange_strong(expected, dplnk::registration_status::running, std::memory_order_acq_rel)) {
+            settle(*state, dplnk::registration_status::cancelled, async);
+            return;
+        }
+
+        try {
+            dplnk::dplnk(path, std::move(options));
+        } catch (...) {
+            state->failure = std::current_exception();
+            settle(*state, dplnk::registration_status::failed, async);
+            return;
+        }
+
+        settle(*state, dplnk::registration_status::completed, async);
+    }
+} // namespace
+
+dplnk::registration::registration(std::shared_ptr<detail::registration_state> state) noexcept : state{ std::move(state) } {}
+
+dplnk::registration_status dplnk::registration::status() const noexcept {
+    return state ? state->status.load(std::memory_order_acquire) : registration_status::cancelled;
+}
+
+bool dplnk::registration::ready() const noexcept {
+    const auto current = status();
+    return current != registration_status::pending && current != registration_status::running;
+}
+
+bool dplnk::registration::cancel() noexcept {
+    if (!state) {
+        return false;
+    }
+
+    auto expected = registration_status::pending;
+    if (!state->status.compare_exchange_strong(expected, registration_status::cancelled, std::memory_order_acq_rel)) {
+        return false;
+    }
+
+    // Wake the worker if it is parked waiting for idle
+    const auto& idle = gate();
+    { std::lock_guard lock{ idle->mutex }; }
+    idle->signal.notify_all();
+    return true;
+}
+
+void dplnk::registration::wait() const {
+    if (!state) {
+        return;
+    }
+
+    std::unique_lock lock{ state->mutex };
+    state->settled.wait(lock, [this] { return ready(); });
+}
+
+bool dplnk::registration::wait_for(std::chrono::milliseconds timeout) const {
+    if (!state) {
+        return true;
+    }
+
+    std::unique_lock lock{ state->mutex };
+    return state->settled.wait_for(lock, timeout, [this] { return ready(); });
+}
+
+void dplnk::registration::get() const {
+    wait();
+
+    if (state && state->failure) {
+        std::rethrow_exception(state->failure);
+    }
+}
+
+dplnk::registration::operator bool() const noexcept {
+    return static_cast<bool>(state);
+}
+
+dplnk::registration dplnk::register_async(const std::string& path, dplnk::options options, dplnk::async_options async) {
+    auto state = std::make_shared<detail::registration_state>();
+
+    // Taken here rather than on the worker, so a `notify_idle` racing the thread start still counts
+    auto idle = gate();
+    std::uint64_t epoch;
+    {
+        std::lock_guard lock{ idle->mutex };
+        epoch = idle->epoch;
+    }
+
+    std::thread{ run, state, path, std::move(options), std::move(async), std::move(idle), epoch }.detach();
+
+    return registration{ std::move(state) };
+}
+
+void dplnk::notify_idle() noexcept {
+    const auto& idle = gate();
+    {
+        std::lock_guard lock{ idle->mutex };
+        ++idle->epoch;
+    }
+    idle->signal.notify_all();
+}
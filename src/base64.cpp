@@ -0,0 +1,301 @@
+﻿#include "base64.h"
+#include "link.h"
+
+#include "simd.hpp"
+
+#include <array>
+#include <cstdint>
+
+namespace {
+    constexpr char alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-_";
+
+    constexpr std::uint8_t invalid = 0xff;
+
+    constexpr auto values = [] {
+        std::array<std::uint8_t, 256> table{};
+        table.fill(invalid);
+        for (std::uint8_t i = 0; i < 64; ++i) {
+            table[static_cast<unsigned char>(alphabet[i])] = i;
+        }
+        return table;
+    }();
+
+    std::uint8_t value_of(char c) noexcept {
+        return values[static_cast<unsigned char>(c)];
+    }
+
+#ifdef DPLNK_X86
+    // Encoding and decoding kernels after Muła and Lemire, "Faster Base64 Encoding and Decoding using AVX2 Instructions"
+
+    DPLNK_TARGET("ssse3") __m128i encode_lookup(__m128i indices) noexcept {
+        __m128i offsets = _mm_subs_epu8(indices, _mm_set1_epi8(51));
+        const __m128i letters = _mm_cmpgt_epi8(_mm_set1_epi8(26), indices);
+        offsets = _mm_or_si128(offsets, _mm_and_si128(letters, _mm_set1_epi8(13)));
+
+        const __m128i shift = _mm_setr_epi8(
+            'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+            '0' - 52, '0' - 52, '0' - 52, '-' - 62, '_' - 63, 'A', 0, 0);
+
+        return _mm_add_epi8(indices, _mm_shuffle_epi8(shift, offsets));
+    }
+
+    DPLNK_TARGET("ssse3") __m128i encode_split(__m128i in) noexcept {
+        in = _mm_shuffle_epi8(in, _mm_set_epi8(10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1));
+
+        const __m128i high = _mm_mulhi_epu16(_mm_and_si128(in, _mm_set1_epi32(0x0fc0fc00)), _mm_set1_epi32(0x04000040));
+        const __m128i low = _mm_mullo_epi16(_mm_and_si128(in, _mm_set1_epi32(0x003f03f0)), _mm_set1_epi32(0x01000010));
+
+        return _mm_or_si128(high, low);
+    }
+
+    // Consumes 12 bytes per round, but reads 16
+    DPLNK_TARGET("ssse3") void encode_ssse3(const std::uint8_t*& in, const std::uint8_t* end, char*& out) noexcept {
+        while (end - in >= 16) {
+            const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out), encode_lookup(encode_split(chunk)));
+            in += 12;
+            out += 16;
+        }
+    }
+
+    DPLNK_TARGET("avx2") __m256i encode_lookup(__m256i indices) noexcept {
+        __m256i offsets = _mm256_subs_epu8(indices, _mm256_set1_epi8(51));
+        const __m256i letters = _mm256_cmpgt_epi8(_mm256_set1_epi8(26), indices);
+        offsets = _mm256_or_si256(offsets, _mm256_and_si256(letters, _mm256_set1_epi8(13)));
+
+        const __m256i shift = _mm256_setr_epi8(
+            'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+            '0' - 52, '0' - 52, '0' - 52, '-' - 62, '_' - 63, 'A', 0, 0,
+            'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+            '0' - 52, '0' - 52, '0' - 52, '-' - 62, '_' - 63, 'A', 0, 0);
+
+        return _mm256_add_epi8(indices, _mm256_shuffle_epi8(shift, offsets));
+    }
+
+    // Consumes 24 bytes per round, but reads 28
+    DPLNK_TARGET("avx2") void encode_avx2(const std::uint8_t*& in, const std::uint8_t* end, char*& out) noexcept {
+        const __m256i order = _mm256_set_epi8(
+            10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1,
+            10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1);
+
+        while (end - in >= 28) {
+            __m256i chunk = _mm256_inserti128_si256(
+                _mm256_castsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(in))),
+                _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + 12)), 1);
+            chunk = _mm256_shuffle_epi8(chunk, order);
+
+            const __m256i high = _mm256_mulhi_epu16(_mm256_and_si256(chunk, _mm256_set1_epi32(0x0fc0fc00)), _mm256_set1_epi32(0x04000040));
+            const __m256i low = _mm256_mullo_epi16(_mm256_and_si256(chunk, _mm256_set1_epi32(0x003f03f0)), _mm256_set1_epi32(0x01000010));
+
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(out), encode_lookup(_mm256_or_si256(high, low)));
+            in += 24;
+            out += 32;
+        }
+    }
+
+    DPLNK_TARGET("ssse3") __m128i in_range(__m128i c, char lo, char hi) noexcept {
+        return _mm_and_si128(_mm_cmpgt_epi8(c, _mm_set1_epi8(static_cast<char>(lo - 1))), _mm_cmpgt_epi8(_mm_set1_epi8(static_cast<char>(hi + 1)), c));
+    }
+
+    // Consumes 16 characters per round, writes 16 bytes of which 12 are output. Stops at the first
+    // block containing a character outside the alphabet and leaves it to the scalar path to reject.
+    DPLNK_TARGET("ssse3") void decode_ssse3(const char*& in, const char* end, std::uint8_t*& out, const std::uint8_t* out_end) noexcept {
+        while (end - in >= 16 && out_end - out >= 16) {
+            const __m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in));
+
+            const __m128i upper = in_range(c, 'A', 'Z');
+            const __m128i lower = in_range(c, 'a', 'z');
+            const __m128i digit = in_range(c, '0', '9');
+            const __m128i dash = _mm_cmpeq_epi8(c, _mm_set1_epi8('-'));
+            const __m128i underscore = _mm_cmpeq_epi8(c, _mm_set1_epi8('_'));
+
+            const __m128i valid = _mm_or_si128(_mm_or_si128(_mm_or_si128(upper, lower), _mm_or_si128(digit, dash)), underscore);
+            if (_mm_movemask_epi8(valid) != 0xffff) {
+                return;
+            }
+
+            __m128i sextets = _mm_and_si128(upper, _mm_sub_epi8(c, _mm_set1_epi8('A')));
+            sextets = _mm_or_si128(sextets, _mm_and_si128(lower, _mm_sub_epi8(c, _mm_set1_epi8('a' - 26))));
+            sextets = _mm_or_si128(sextets, _mm_and_si128(digit, _mm_add_epi8(c, _mm_set1_epi8(52 - '0'))));
+            sextets = _mm_or_si128(sextets, _mm_and_si128(dash, _mm_set1_epi8(62)));
+            sextets = _mm_or_si128(sextets, _mm_and_si128(underscore, _mm_set1_epi8(63)));
+
+            const __m128i pairs = _mm_maddubs_epi16(sextets, _mm_set1_epi32(0x01400140));
+            __m128i packed = _mm_madd_epi16(pairs, _mm_set1_epi32(0x00011000));
+            packed = _mm_shuffle_epi8(packed, _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1));
+
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out), packed);
+            in += 16;
+            out += 12;
+        }
+    }
+
+    DPLNK_TARGET("avx2") __m256i in_range(__m256i c, char lo, char hi) noexcept {
+        return _mm256_and_si256(_mm256_cmpgt_epi8(c, _mm256_set1_epi8(static_cast<char>(lo - 1))), _mm256_cmpgt_epi8(_mm256_set1_epi8(static_cast<char>(hi + 1)), c));
+    }
+
+    // Consumes 32 characters per round, writes 32 bytes of which 24 are output
+    DPLNK_TARGET("avx2") void decode_avx2(const char*& in, const char* end, std::uint8_t*& out, const std::uint8_t* out_end) noexcept {
+        const __m256i order = _mm256_setr_epi8(
+            2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1,
+            2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1);
+
+        while (end - in >= 32 && out_end - out >= 32) {
+            const __m256i c = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in));
+
+            const __m256i upper = in_range(c, 'A', 'Z');
+            const __m256i lower = in_range(c, 'a', 'z');
+            const __m256i digit = in_range(c, '0', '9');
+            const __m256i dash = _mm256_cmpeq_epi8(c, _mm256_set1_epi8('-'));
+            const __m256i underscore = _mm256_cmpeq_epi8(c, _mm256_set1_epi8('_'));
+
+            const __m256i valid = _mm256_or_si256(_mm256_or_si256(_mm256_or_si256(upper, lower), _mm256_or_si256(digit, dash)), underscore);
+            if (static_cast<std::uint32_t>(_mm256_movemask_epi8(valid)) != 0xffffffffu) {
+                return;
+            }
+
+            __m256i sextets = _mm256_and_si256(upper, _mm256_sub_epi8(c, _mm256_set1_epi8('A')));
+            sextets = _mm256_or_si256(sextets, _mm256_and_si256(lower, _mm256_sub_epi8(c, _mm256_set1_epi8('a' - 26))));
+            sextets = _mm256_or_si256(sextets, _mm256_and_si256(digit, _mm256_add_epi8(c, _mm256_set1_epi8(52 - '0'))));
+            sextets = _mm256_or_si256(sextets, _mm256_and_si256(dash, _mm256_set1_epi8(62)));
+            sextets = _mm256_or_si256(sextets, _mm256_and_si256(underscore, _mm256_set1_epi8(63)));
+
+            const __m256i pairs = _mm256_maddubs_epi16(sextets, _mm256_set1_epi32(0x01400140));
+            __m256i packed = _mm256_madd_epi16(pairs, _mm256_set1_epi32(0x00011000));
+            packed = _mm256_shuffle_epi8(packed, order);
+            packed = _mm256_permutevar8x32_epi32(packed, _mm256_setr_epi32(0, 1, 2, 4, 5, 6, 3, 7));
+
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(out), packed);
+            in += 32;
+            out += 24;
+        }
+    }
+#endif
+} // namespace
+
+bool dplnk::detail::supports(base64_kernel kernel) noexcept {
+    switch (kernel) {
+    case base64_kernel::avx2:
+        return cpu().avx2;
+    case base64_kernel::ssse3:
+        return cpu().ssse3;
+    default:
+        return true;
+    }
+}
+
+std::optional<std::size_t> dplnk::base64url_encode(std::span<const std::byte> in, std::span<char> out) noexcept {
+    return detail::base64url_encode(in, out, detail::base64_kernel::best);
+}
+
+std::optional<std::size_t> dplnk::detail::base64url_encode(std::span<const std::byte> in, std::span<char> out, [[maybe_unused]] base64_kernel kernel) noexcept {
+    if (out.size() < base64url_encoded_size(in.size())) {
+        return std::nullopt;
+    }
+
+    const auto* src = reinterpret_cast<const std::uint8_t*>(in.data());
+    const auto* const end = src + in.size();
+    char* dst = out.data();
+
+#ifdef DPLNK_X86
+    if (kernel >= base64_kernel::avx2 && cpu().avx2) {
+        encode_avx2(src, end, dst);
+    }
+    if (kernel >= base64_kernel::ssse3 && cpu().ssse3) {
+        encode_ssse3(src, end, dst);
+    }
+#endif
+
+    for (; end - src >= 3; src += 3) {
+        const std::uint32_t triple = (std::uint32_t{ src[0] } << 16) | (std::uint32_t{ src[1] } << 8) | src[2];
+        *dst++ = alphabet[(triple >> 18) & 0x3f];
+        *dst++ = alphabet[(triple >> 12) & 0x3f];
+        *dst++ = alphabet[(triple >> 6) & 0x3f];
+        *dst++ = alphabet[triple & 0x3f];
+    }
+
+    if (end - src == 2) {
+        const std::uint32_t pair = (std::uint32_t{ src[0] } << 8) | src[1];
+        *dst++ = alphabet[(pair >> 10) & 0x3f];
+        *dst++ = alphabet[(pair >> 4) & 0x3f];
+        *dst++ = alphabet[(pair << 2) & 0x3f];
+    } else if (end - src == 1) {
+        *dst++ = alphabet[src[0] >> 2];
+        *dst++ = alphabet[(src[0] << 4) & 0x3f];
+    }
+
+    return static_cast<std::size_t>(dst - out.data());
+}
+
+std::optional<std::size_t> dplnk::base64url_decode(std::string_view in, std::span<std::byte> out) noexcept {
+    return detail::base64url_decode(in, out, detail::base64_kernel::best);
+}
+
+std::optional<std::size_t> dplnk::detail::base64url_decode(std::string_view in, std::span<std::byte> out, [[maybe_unused]] base64_kernel kernel) noexcept {
+    if (in.size() % 4 == 1 || out.size() < base64url_decoded_size(in.size())) {
+        return std::nullopt;
+    }
+
+    const char* src = in.data();
+    const char* const end = src + in.size();
+    auto* dst = reinterpret_cast<std::uint8_t*>(out.data());
+    const auto* const dst_end = dst + out.size();
+
+#ifdef DPLNK_X86
+    if (kernel >= base64_kernel::avx2 && cpu().avx2) {
+        decode_avx2(src, end, dst, dst_end);
+    }
+    if (kernel >= base64_kernel::ssse3 && cpu().ssse3) {
+        decode_ssse3(src, end, dst, dst_end);
+    }
+#endif
+
+    for (; end - src >= 4; src += 4) {
+        const std::uint32_t a = value_of(src[0]);
+        const std::uint32_t b = value_of(src[1]);
+        const std::uint32_t c = value_of(src[2]);
+        const std::uint32_t d = value_of(src[3]);
+        if ((a | b | c | d) == invalid) {
+            return std::nullopt;
+        }
+
+        const std::uint32_t triple = (a << 18) | (b << 12) | (c << 6) | d;
+        *dst++ = static_cast<std::uint8_t>(triple >> 16);
+        *dst++ = static_cast<std::uint8_t>(triple >> 8);
+        *dst++ = static_cast<std::uint8_t>(triple);
+    }
+
+    // The unused low bits of a partial group must be zero, otherwise two encodings would decode alike
+    if (end - src == 3) {
+        const std::uint32_t a = value_of(src[0]);
+        const std::uint32_t b = value_of(src[1]);
+        const std::uint32_t c = value_of(src[2]);
+        if ((a | b | c) == invalid || (c & 0x3) != 0) {
+            return std::nullopt;
+        }
+
+        const std::uint32_t pair = (a << 10) | (b << 4) | (c >> 2);
+        *dst++ = static_cast<std::uint8_t>(pair >> 8);
+        *dst++ = static_cast<std::uint8_t>(pair);
+    } else if (end - src == 2) {
+        const std::uint32_t a = value_of(src[0]);
+        const std::uint32_t b = value_of(src[1]);
+        if ((a | b) == invalid || (b & 0xf) != 0) {
+            return std::nullopt;
+        }
+
+        *dst++ = static_cast<std::uint8_t>((a << 2) | (b >> 4));
+    }
+
+    return static_cast<std::size_t>(dst - reinterpret_cast<std::uint8_t*>(out.data()));
+}
+
+std::optional<std::size_t> dplnk::base64url_decode_param(std::string_view link, std::string_view key, std::span<std::byte> out) noexcept {
+    // The base64url alphabet is all unreserved characters, so the raw parameter is the encoding itself
+    const auto value = find_param(split_link(link).query, key);
+    if (!value) {
+        return std::nullopt;
+    }
+
+    return base64url_decode(*value, out);
+}
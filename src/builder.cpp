@@ -0,0 +1,218 @@
+﻿#include "builder.h"
+
+#include "simd.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <stdexcept>
+
+namespace {
+    constexpr auto unreserved = [] {
+        std::array<bool, 256> table{};
+        for (unsigned c = 0; c < 256; ++c) {
+            table[c] = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '-' || c == '.' || c == '_' || c == '~';
+        }
+        return table;
+    }();
+
+    constexpr char hex[] = "0123456789ABCDEF";
+
+    // Writes `%XX` for bytes that need it, returns false once `out` is full
+    bool put(char c, std::span<char> out, std::size_t& size) noexcept {
+        const auto byte = static_cast<unsigned char>(c);
+        if (unreserved[byte]) {
+            if (size == out.size()) {
+                return false;
+            }
+            out[size++] = c;
+            return true;
+        }
+
+        if (out.size() - size < 3) {
+            return false;
+        }
+        out[size++] = '%';
+        out[size++] = hex[byte >> 4];
+        out[size++] = hex[byte & 0x0f];
+        return true;
+    }
+
+#if defined(__SSE2__) || defined(_M_X64)
+    // One bit per byte of `chunk` that goes out unchanged. Compares are signed, so bytes from 0x80 up fail every range.
+    unsigned unreserved_mask(__m128i chunk) noexcept {
+        const auto within = [](__m128i c, char low, char high) {
+            return _mm_and_si128(_mm_cmpgt_epi8(c, _mm_set1_epi8(static_cast<char>(low - 1))), _mm_cmplt_epi8(c, _mm_set1_epi8(static_cast<char>(high + 1))));
+        };
+
+        // Setting 0x20 folds uppercase onto lowercase without pulling any other byte into a-z
+        const __m128i letters = within(_mm_or_si128(chunk, _mm_set1_epi8(0x20)), 'a', 'z');
+        const __m128i digits = within(chunk, '0', '9');
+        const __m128i marks = _mm_or_si128(within(chunk, '-', '.'), _mm_or_si128(_mm_cmpeq_epi8(chunk, _mm_set1_epi8('_')), _mm_cmpeq_epi8(chunk, _mm_set1_epi8('~'))));
+
+        return static_cast<unsigned>(_mm_movemask_epi8(_mm_or_si128(_mm_or_si128(letters, digits), marks)));
+    }
+#endif
+} // namespace
+
+std::optional<std::size_t> dplnk::percent_encode(std::string_view in, std::span<char> out) noexcept {
+    std::size_t at = 0;
+    std::size_t size = 0;
+
+#if defined(__SSE2__) || defined(_M_X64)
+    // Identifiers, names and tokens are mostly unreserved: such chunks are stored as is, sixteen bytes at a time
+    for (; in.size() - at >= 16; at += 16) {
+        const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in.data() + at));
+        const unsigned mask = unreserved_mask(chunk);
+
+        if (mask == 0xffff && out.size() - size >= 16) {
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out.data() + size), chunk);
+            size += 16;
+            continue;
+        }
+
+        for (std::size_t i = 0; i < 16; ++i) {
+            if (!put(in[at + i], out, size)) {
+                return std::nullopt;
+            }
+        }
+    }
+#endif
+
+    for (; at < in.size(); ++at) {
+        if (!put(in[at], out, size)) {
+            return std::nullopt;
+        }
+    }
+
+    return size;
+}
+
+dplnk::link_builder::link_builder(std::string_view protocol, std::span<char> buffer) : data{ buffer.data() }, capacity{ buffer.size() } {
+    if (!is_valid_scheme(protocol)) {
+        throw std::invalid_argument("Invalid protocol: '" + std::string{ protocol } + "' is not a valid URL scheme");
+    }
+
+    append(protocol);
+    append("://");
+}
+
+dplnk::link_builder::link_builder(std::string_view protocol, std::pmr::memory_resource& memory, std::size_t reserve) : memory{ &memory } {
+    if (!is_valid_scheme(protocol)) {
+        throw std::invalid_argument("Invalid protocol: '" + std::string{ protocol } + "' is not a valid URL scheme");
+    }
+
+    static_cast<void>(this->reserve((std::max)(reserve, protocol.size() + 3)));
+    append(protocol);
+    append("://");
+}
+
+dplnk::link_builder::~link_builder() {
+    if (memory != nullptr && data != nullptr) {
+        memory->deallocate(data, capacity, 1);
+    }
+}
+
+dplnk::link_builder& dplnk::link_builder::segment(std::string_view text) {
+    enter(part::route);
+    append_encoded(text);
+    return *this;
+}
+
+dplnk::link_builder& dplnk::link_builder::fragment(std::string_view text) {
+    enter(part::fragment);
+    append_encoded(text);
+    return *this;
+}
+
+dplnk::link_builder& dplnk::link_builder::encoded_param(std::string_view key, std::string_view value) {
+    enter(part::query);
+    append_encoded(key);
+    append("=");
+    append_encoded(value);
+    return *this;
+}
+
+dplnk::link_builder& dplnk::link_builder::plain_param(std::string_view key, std::string_view value) {
+    enter(part::query);
+    append_encoded(key);
+    append("=");
+    append(value);
+    return *this;
+}
+
+std::optional<std::string_view> dplnk::link_builder::link() const noexcept {
+    if (overflow) {
+        return std::nullopt;
+    }
+    return std::string_view{ data, size };
+}
+
+std::string dplnk::link_builder::str() const {
+    return std::string{ link().value_or(std::string_view{}) };
+}
+
+void dplnk::link_builder::enter(part next) {
+    if (next < current || (next == part::fragment && current == part::fragment)) {
+        throw std::logic_error("dplnk::link_builder: segments, parameters and the fragment go in that order");
+    }
+
+    if (next != current) {
+        append(next == part::query ? "?" : "#");
+        current = next;
+        first = true;
+    }
+
+    if (!first) {
+        append(current == part::route ? "/" : "&");
+    }
+    first = false;
+}
+
+void dplnk::link_builder::append(std::string_view text) {
+    if (overflow || !reserve(text.size())) {
+        return;
+    }
+
+    std::memcpy(data + size, text.data(), text.size());
+    size += text.size();
+}
+
+void dplnk::link_builder::append_encoded(std::string_view text) {
+    // Growing memory makes room for the worst case up front, so the encoder never runs out halfway
+    if (overflow || (memory != nullptr && !reserve(text.size() * 3))) {
+        return;
+    }
+
+    const auto written = percent_encode(text, { data + size, capacity - size });
+    if (!written) {
+        overflow = true;
+        return;
+    }
+    size += *written;
+}
+
+bool dplnk::link_builder::reserve(std::size_t bytes) {
+    if (capacity - size >= bytes) {
+        return true;
+    }
+
+    if (memory == nullptr) {
+        overflow = true;
+        return false;
+    }
+
+    // An arena never gets the old block back, doubling keeps the waste to the size of the final link
+    const std::size_t grown = (std::max)(capacity * 2, size + bytes);
+    auto* const block = static_cast<char*>(memory->allocate(grown, 1));
+    if (size != 0) {
+        std::memcpy(block, data, size);
+    }
+    if (data != nullptr) {
+        memory->deallocate(data, capacity, 1);
+    }
+
+    data = block;
+    capacity = grown;
+    return true;
+}
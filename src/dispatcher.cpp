@@ -0,0 +1,264 @@
+﻿#include "dispatcher.h"
+
+#include "metrics.h"
+#include "trace.h"
+
+#include <algorithm>
+
+dplnk::dispatcher::dispatcher(dplnk::dispatcher_options options) : memory{ options.memory }, journal{ options.journal } {
+    workers.reserve(options.workers);
+    for (std::size_t i = 0; i < options.workers; ++i) {
+        workers.emplace_back([this](std::stop_token stop) { work(stop); });
+    }
+}
+
+dplnk::dispatcher::~dispatcher() {
+    for (auto& worker : workers) {
+        worker.request_stop();
+    }
+    wake.notify_all();
+    workers.clear();
+
+    for (auto* queue : { &main, &deferred, &background }) {
+        while (task* const task = queue->pop()) {
+            retire(task);
+        }
+    }
+}
+
+void dplnk::dispatcher::on(std::string route, dplnk::handler handler, dplnk::handler_options options) {
+    auto [it, inserted] = routes.try_emplace(std::move(route));
+    it->second.handler = std::move(handler);
+    it->second.options = options;
+}
+
+void dplnk::dispatcher::otherwise(dplnk::handler handler, dplnk::handler_options options) {
+    fallback_entry.handler = std::move(handler);
+    fallback_entry.options = options;
+    fallback = &fallback_entry;
+}
+
+dplnk::dispatcher::entry* dplnk::dispatcher::find(std::string_view route) {
+    const auto it = routes.find(route);
+    return it != routes.end() ? &it->second : fallback;
+}
+
+bool dplnk::dispatcher::dispatch(std::string_view link, dplnk::link_source source) {
+    DPLNK_TRACE_LINK_SPAN("dispatch", hash_link(link));
+    DPLNK_TRACE_FLOW_END("link", hash_link(link));
+
+    const std::uint64_t sequence = journal != nullptr ? journal->received(link, source) : 0;
+
+    entry* const entry = find(route_of(link));
+    if (entry == nullptr) {
+        unhandled.fetch_add(1, std::memory_order_relaxed);
+        if (journal != nullptr) {
+            journal->outcome(sequence, journal_record::unhandled);
+        }
+        return false;
+    }
+
+    dispatched.fetch_add(1, std::memory_order_relaxed);
+
+    arena* const arena = memory.acquire();
+
+    task* task = nullptr;
+    try {
+        task = arena->make<dispatcher::task>();
+        task->entry = entry;
+        task->sequence = sequence;
+        task->queued = std::chrono::steady_clock::now();
+
+        const std::string_view text = arena->copy(link);
+        const auto parts = split_link(text);
+        task->params = query_view{ parts.query };
+        task->event = { text, parts.route, parts.query, hash_link(text), &task->params, arena };
+
+        std::lock_guard lock{ mutex };
+        switch (entry->options.target) {
+        case target::main_thread:
+            main.push(task);
+            break;
+        case target::worker:
+            background.push(task);
+            break;
+        case target::deferred:
+            deferred.push(task);
+            break;
+        }
+    } catch (...) {
+        memory.release(arena);
+        throw;
+    }
+
+    if (entry->options.target == target::worker) {
+        wake.notify_one();
+    }
+    return true;
+}
+
+void dplnk::dispatcher::retire(task* task) noexcept {
+    memory.release(task->event.memory);
+}
+
+bool dplnk::dispatcher::advance(task& task) {
+    entry& entry = *task.entry;
+    const auto start = std::chrono::steady_clock::now();
+
+    if (task.queued != std::chrono::steady_clock::time_point{}) {
+        latency(metric::queue).record(start - task.queued);
+        DPLNK_TRACE_INTERVAL("queue", task.event.id, task.queued, start);
+        task.queued = {};
+    }
+
+    step result = step::done;
+    bool threw = false;
+    try {
+        result = entry.handler(task.event);
+    } catch (...) {
+        threw = true;
+    }
+
+    const auto finish = std::chrono::steady_clock::now();
+    const auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(finish - start);
+    DPLNK_TRACE_INTERVAL("handler", task.event.id, start, finish);
+
+    latency(metric::handler).record(elapsed);
+
+    entry.steps.fetch_add(1, std::memory_order_relaxed);
+    if (elapsed > entry.options.budget) {
+        entry.overruns.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    std::int64_t worst = entry.worst.load(std::memory_order_relaxed);
+    while (elapsed.count() > worst && !entry.worst.compare_exchange_weak(worst, elapsed.count(), std::memory_order_relaxed)) {}
+
+    if (threw) {
+        failed.fetch_add(1, std::memory_order_relaxed);
+        if (journal != nullptr) {
+            journal->outcome(task.sequence, journal_record::failed);
+        }
+        return false;
+    }
+
+    if (result == step::done) {
+        completed.fetch_add(1, std::memory_order_relaxed);
+        if (journal != nullptr) {
+            journal->outcome(task.sequence, journal_record::completed);
+        }
+        return false;
+    }
+
+    return true;
+}
+
+std::size_t dplnk::dispatcher::run(std::chrono::microseconds frame_budget) {
+    const auto deadline = std::chrono::steady_clock::now() + frame_budget;
+
+    std::size_t steps = 0;
+    do {
+        task* task = nullptr;
+        {
+            std::lock_guard lock{ mutex };
+            task = main.pop();
+        }
+        if (task == nullptr) {
+            break;
+        }
+
+        ++steps;
+        if (!advance(*task)) {
+            retire(task);
+            continue;
+        }
+
+        // Round-robin so one long handler cannot starve the rest
+        std::lock_guard lock{ mutex };
+        main.push(task);
+    } while (std::chrono::steady_clock::now() < deadline);
+
+    return steps;
+}
+
+std::size_t dplnk::dispatcher::run_deferred() {
+    std::size_t steps = 0;
+
+    while (true) {
+        task* task = nullptr;
+        {
+            std::lock_guard lock{ mutex };
+            task = deferred.pop();
+        }
+        if (task == nullptr) {
+            break;
+        }
+
+        do {
+            ++steps;
+        } while (advance(*task));
+        retire(task);
+    }
+
+    return steps;
+}
+
+void dplnk::dispatcher::work(std::stop_token stop) {
+    while (true) {
+        task* task = nullptr;
+        {
+            std::unique_lock lock{ mutex };
+            if (!wake.wait(lock, stop, [this] { return !background.empty(); })) {
+                return;
+            }
+            task = background.pop();
+        }
+
+        if (!advance(*task)) {
+            retire(task);
+            continue;
+        }
+
+        {
+            std::lock_guard lock{ mutex };
+            background.push(task);
+        }
+        wake.notify_one();
+    }
+}
+
+std::size_t dplnk::dispatcher::pending() const {
+    std::lock_guard lock{ mutex };
+    return main.size() + deferred.size() + background.size();
+}
+
+dplnk::dispatch_stats dplnk::dispatcher::stats() const {
+    dispatch_stats stats;
+    stats.dispatched = dispatched.load(std::memory_order_relaxed);
+    stats.unhandled = unhandled.load(std::memory_order_relaxed);
+    stats.completed = completed.load(std::memory_order_relaxed);
+    stats.failed = failed.load(std::memory_order_relaxed);
+
+    const auto accumulate = [&](const entry& entry) {
+        stats.watchdog.steps += entry.steps.load(std::memory_order_relaxed);
+        stats.watchdog.overruns += entry.overruns.load(std::memory_order_relaxed);
+        stats.watchdog.worst = std::max(stats.watchdog.worst, std::chrono::nanoseconds{ entry.worst.load(std::memory_order_relaxed) });
+    };
+
+    for (const auto& [route, entry] : routes) {
+        accumulate(entry);
+    }
+    accumulate(fallback_entry);
+
+    return stats;
+}
+
+dplnk::watchdog_stats dplnk::dispatcher::watchdog(std::string_view route) const {
+    const auto it = routes.find(route);
+    const entry& entry = it != routes.end() ? it->second : fallback_entry;
+
+    return {
+        entry.steps.load(std::memory_order_relaxed),
+        entry.overruns.load(std::memory_order_relaxed),
+        std::chrono::nanoseconds{ entry.worst.load(std::memory_order_relaxed) },
+    };
+}
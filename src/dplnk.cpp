@@ -1,34 +1,555 @@
 ﻿#include "dplnk.h"
 
+#include "lookup.h"
+#include "metrics.h"
+#include "scheme.hpp"
+#include "trace.h"
+#include "transaction.h"
+
+#include <algorithm>
+
 #ifdef _WIN32 // Windows
 #include "subsystems/windows.h"
+
+namespace {
+    // One span per registry call, so a slow hive shows up in the trace
+    template<typename Operation>
+    decltype(auto) traced([[maybe_unused]] const char* name, Operation&& operation) {
+        DPLNK_TRACE_SPAN(name);
+        return operation();
+    }
+
+    // Through the `try*` calls, so a failure is a returned `RegResult` rather than a thrown `RegException`
+    std::expected<void, dplnk::error> write_keys(const dplnk::detail::scheme_keys& keys, const std::string& path, const std::optional<std::map<std::string, std::string>>& d, dplnk::report& report) noexcept {
+        std::optional<dplnk::error> failed;
+        const auto step = [&](const char* name, auto&& operation) {
+            const WinReg::RegResult result = traced(name, operation);
+            if (result.failed()) {
+                failed = dplnk::error{ std::error_code{ static_cast<int>(result.code()), std::system_category() }, name };
+                return false;
+            }
+            ++report.writes;
+            return true;
+        };
+
+        WinReg::RegKey protocolkey;
+        WinReg::RegKey iconkey;
+        WinReg::RegKey cmdkey;
+        const std::wstring wpath(path.begin(), path.end());
+
+        const bool written = step("RegKey::create protocol", [&] { return protocolkey.tryCreate(HKEY_CLASSES_ROOT, std::wstring{ keys.key }); })
+            && step("RegKey::setStringValue description", [&] { return protocolkey.trySetStringValue(L"", std::wstring{ keys.description }); })
+            && step("RegKey::setStringValue URL Protocol", [&] { return protocolkey.trySetStringValue(L"URL Protocol", L""); })
+            && step("RegKey::create DefaultIcon", [&] { return iconkey.tryCreate(HKEY_CLASSES_ROOT, std::wstring{ keys.icon_key }); })
+            && step("RegKey::setStringValue DefaultIcon", [&] { return iconkey.trySetStringValue(L"", L"C:\\Windows\\System32\\url.dll,0"); })
+            && step("RegKey::create command", [&] { return cmdkey.tryCreate(HKEY_CLASSES_ROOT, std::wstring{ keys.command_key }); })
+            && step("RegKey::setStringValue command", [&] { return cmdkey.trySetStringValue(L"", L"\"" + wpath + L"\" %1"); });
+
+        if (written && d.has_value()) {
+            for (const auto& [key, value] : *d) {
+                const std::wstring wkey(key.begin(), key.end());
+                const std::wstring wvalue(value.begin(), value.end());
+
+                if (!step("RegKey::setStringValue d", [&] { return cmdkey.trySetStringValue(wkey, wvalue); })) {
+                    break;
+                }
+            }
+        }
+
+        if (failed.has_value()) {
+            return std::unexpected{ *failed };
+        }
+        return {};
+    }
+
+    // Windows paths compare case-insensitively
+    bool same_path(std::string_view a, std::string_view b) noexcept {
+        constexpr auto lower = [](char c) { return c >= 'A' && c <= 'Z' ? static_cast<char>(c - 'A' + 'a') : c; };
+        return a.size() == b.size() && std::equal(a.begin(), a.end(), b.begin(), [&](char x, char y) { return lower(x) == lower(y); });
+    }
+
+    // Whether `HKCR\<protocol>` has the layout `write_keys` gives it: the description, the `URL Protocol` marker and a
+    // `"<path>" %1` command. Schemes such as `http` belong to the system or another program and are never deleted.
+    bool written_by_dplnk(const std::wstring& protocol) {
+        constexpr auto lower = [](wchar_t c) { return c >= L'A' && c <= L'Z' ? static_cast<wchar_t>(c - L'A' + L'a') : c; };
+        const auto same_text = [&](std::wstring_view a, std::wstring_view b) {
+            return a.size() == b.size() && std::equal(a.begin(), a.end(), b.begin(), [&](wchar_t x, wchar_t y) { return lower(x) == lower(y); });
+        };
+
+        WinReg::RegKey protocolkey;
+        if (!protocolkey.tryOpen(HKEY_CLASSES_ROOT, protocol, KEY_READ)) {
+            return false;
+        }
+
+        const auto description = protocolkey.tryGetStringValue(L"");
+        const auto marked = protocolkey.tryHasValue(L"URL Protocol");
+        if (!description || !same_text(description.getValue(), L"URL: " + protocol + L" Protocol") || !marked || !marked.getValue()) {
+            return false;
+        }
+
+        WinReg::RegKey cmdkey;
+        if (!cmdkey.tryOpen(protocolkey.get(), L"shell\\open\\command", KEY_READ)) {
+            return false;
+        }
+
+        const auto command = cmdkey.tryGetStringValue(L"");
+        if (!command) {
+            return false;
+        }
+        const std::wstring_view line = command.getValue();
+        return line.size() >= 6 && line.front() == L'"' && line.ends_with(L"\" %1") && line.find(L'"', 1) == line.size() - 4;
+    }
+} // namespace
+#elif defined(__linux__) // Linux
+#include "xdg.hpp"
+
+#include <cerrno>
+#include <set>
+
+#include <unistd.h>
+
+namespace {
+    std::string narrow(std::wstring_view text) {
+        // Schemes and the description built from them are ASCII
+        std::string narrowed(text.size(), '\0');
+        std::transform(text.begin(), text.end(), narrowed.begin(), [](wchar_t c) { return static_cast<char>(c); });
+        return narrowed;
+    }
+
+    std::unexpected<dplnk::error> failure(std::error_code code, const char* step) noexcept {
+        return std::unexpected{ dplnk::error{ code, step } };
+    }
+
+    std::unexpected<dplnk::error> failure(const char* step) noexcept {
+        return failure({ errno, std::generic_category() }, step);
+    }
+
+    struct staged_file {
+        std::filesystem::path target;
+        std::filesystem::path temporary;
+        // A hard link to the version being replaced, kept until every rename succeeded
+        std::filesystem::path backup;
+    };
+
+    // Stages every file, syncs each staged file, then renames the files into place.
+    // If a rename fails the files already replaced get their previous version back.
+    std::expected<void, dplnk::error> publish(const std::map<std::filesystem::path, std::string>& files, dplnk::report& report) noexcept {
+        std::vector<staged_file> staged;
+        staged.reserve(files.size());
+
+        const auto discard = [&] {
+            for (const auto& file : staged) {
+                unlink(file.temporary.c_str());
+            }
+        };
+
+        std::set<std::filesystem::path> directories;
+        std::error_code error;
+        for (const auto& [target, content] : files) {
+            DPLNK_TRACE_SPAN("stage file");
+            auto temporary = dplnk::detail::xdg::write_temporary(target, content, false, error);
+            if (error) {
+                discard();
+                return failure(error, "stage file");
+            }
+
+            staged.push_back({ target, std::move(temporary), {} });
+            directories.insert(target.parent_path());
+        }
+
+        // One fdatasync per file rather than one syncfs, which would also flush whatever else is dirty on the filesystem.
+        // Staging already started writeback of every file, so these mostly wait on writes that run side by side.
+        for (const auto& file : staged) {
+            DPLNK_TRACE_SPAN("sync file");
+            dplnk::detail::xdg::sync_file(file.temporary, error);
+            if (error) {
+                discard();
+                return failure(error, "sync file");
+            }
+        }
+
+        const auto restore = [&](std::size_t published) {
+            for (std::size_t i = 0; i < staged.size(); ++i) {
+                const auto& file = staged[i];
+                if (!file.backup.empty()) {
+                    rename(file.backup.c_str(), file.target.c_str());
+                } else if (i < published) {
+                    unlink(file.target.c_str());
+                }
+                unlink(file.temporary.c_str());
+            }
+        };
+
+        for (std::size_t published = 0; published < staged.size(); ++published) {
+            auto& file = staged[published];
+
+            auto backup = file.temporary;
+            backup += ".old";
+            if (link(file.target.c_str(), backup.c_str()) == 0) {
+                file.backup = std::move(backup);
+            } else if (errno != ENOENT) {
+                const auto failed = failure("keep previous file");
+                restore(published);
+                return failed;
+            }
+
+            if (rename(file.temporary.c_str(), file.target.c_str()) != 0) {
+                const auto failed = failure("replace file");
+                restore(published);
+                return failed;
+            }
+            ++report.writes;
+        }
+
+        // The renames themselves, one fsync per directory. Too late to roll back, the new files are in place either way.
+        std::optional<dplnk::error> unsynced;
+        for (const auto& directory : directories) {
+            DPLNK_TRACE_SPAN("sync directory");
+            dplnk::detail::xdg::sync_directory(directory, error);
+            if (error && !unsynced.has_value()) {
+                unsynced = dplnk::error{ error, "sync directory" };
+            }
+        }
+
+        for (const auto& file : staged) {
+            if (!file.backup.empty()) {
+                unlink(file.backup.c_str());
+            }
+        }
+
+        if (unsynced.has_value()) {
+            return std::unexpected{ *unsynced };
+        }
+        return {};
+    }
+} // namespace
 #endif
 
-void dplnk::dplnk(const std::string& path, dplnk::options options) {
+namespace {
+    // Step of the error `try_register` returns for a protocol `is_valid_scheme` rejects
+    constexpr const char* validate_protocol = "validate protocol";
+
+    // The exception `dplnk` has always thrown for each kind of failure
+    [[noreturn]] void raise(const dplnk::error& error) {
 #ifdef _WIN32 // Windows
+        if (error.code.category() == std::system_category()) {
+            throw WinReg::RegException{ static_cast<LSTATUS>(error.code.value()), error.step };
+        }
+#endif
+        if (error.code == std::errc::not_supported) {
+            throw std::runtime_error(error.step);
+        }
+        throw std::system_error(error.code, error.step);
+    }
+} // namespace
+
+std::expected<dplnk::report, dplnk::error> dplnk::detail::try_register_scheme(const dplnk::detail::scheme_keys& keys, const std::string& path, const std::optional<std::map<std::string, std::string>>& d) noexcept {
+    const scoped_latency timer{ metric::registration };
+    DPLNK_TRACE_SPAN("register_scheme");
+    const auto start = std::chrono::steady_clock::now();
+
+#ifdef _WIN32 // Windows
+    report report;
+    if (auto written = write_keys(keys, path, d, report); !written) {
+        return std::unexpected{ written.error() };
+    }
+#elif defined(__linux__) // Linux
+    // A transaction of one: the desktop file and both lists are synced together instead of one by one
+    registration_transaction transaction;
+    transaction.entries.push_back({ path, { narrow(keys.key), d } });
+
+    auto committed = transaction.try_commit();
+    if (!committed) {
+        return committed;
+    }
+    report report = *committed;
+#else
+    return std::unexpected{ error{ std::make_error_code(std::errc::not_supported), "Unsupported platform!" } };
+#endif
+
+#if defined(_WIN32) || defined(__linux__)
+    scheme_index::invalidate();
+
+    report.elapsed = std::chrono::steady_clock::now() - start;
+    return report;
+#endif
+}
+
+void dplnk::detail::register_scheme(const dplnk::detail::scheme_keys& keys, const std::string& path, const std::optional<std::map<std::string, std::string>>& d) {
+    if (const auto registered = try_register_scheme(keys, path, d); !registered) {
+        raise(registered.error());
+    }
+}
+
+std::expected<dplnk::report, dplnk::error> dplnk::try_register(const std::string& path, const dplnk::options& options) noexcept {
+    if (!is_valid_scheme(options.protocol)) {
+        return std::unexpected{ error{ std::make_error_code(std::errc::invalid_argument), validate_protocol } };
+    }
+
     const std::wstring wprotocol(options.protocol.begin(), options.protocol.end());
+    const std::wstring wicon = wprotocol + L"\\DefaultIcon";
+    const std::wstring wcommand = wprotocol + L"\\shell\\open\\command";
+    const std::wstring wdescription = L"URL: " + wprotocol + L" Protocol";
 
-    WinReg::RegKey protocolkey{ HKEY_CLASSES_ROOT, wprotocol };
-    protocolkey.setStringValue(L"", L"URL: " + wprotocol + L" Protocol");
-    protocolkey.setStringValue(L"URL Protocol", L"");
+    return detail::try_register_scheme({ wprotocol, wicon, wcommand, wdescription }, path, options.d);
+}
 
-    WinReg::RegKey iconkey{ HKEY_CLASSES_ROOT, wprotocol + L"\\DefaultIcon" };
-    iconkey.setStringValue(L"", L"C:\\Windows\\System32\\url.dll,0");
+void dplnk::dplnk(const std::string& path, dplnk::options options) {
+    if (const auto registered = try_register(path, options); !registered) {
+        if (registered.error().step == validate_protocol) {
+            throw std::invalid_argument("Invalid protocol: '" + options.protocol + "' is not a valid URL scheme");
+        }
+        raise(registered.error());
+    }
+}
 
-    WinReg::RegKey cmdkey{ HKEY_CLASSES_ROOT, wprotocol + L"\\shell\\open\\command" };
+void dplnk::registration_transaction::add(const std::string& path, dplnk::options options) {
+    if (!is_valid_scheme(options.protocol)) {
+        throw std::invalid_argument("Invalid protocol: '" + options.protocol + "' is not a valid URL scheme");
+    }
+
+    entries.push_back({ path, std::move(options) });
+}
+
+std::expected<dplnk::report, dplnk::error> dplnk::registration_transaction::try_commit() noexcept {
+    report report;
+    if (entries.empty()) {
+        return report;
+    }
+    DPLNK_TRACE_SPAN("registration_transaction::commit");
+    const auto start = std::chrono::steady_clock::now();
+
+#ifdef _WIN32 // Windows
+    // Borrowed, the predefined handle is detached again instead of being closed
+    WinReg::RegKey classes{ HKEY_CLASSES_ROOT };
+
+    // Only schemes this transaction created are deleted on failure, existing ones keep whatever was written
+    std::vector<std::wstring> created;
+    std::expected<void, error> written;
+    for (const auto& [path, options] : entries) {
+        const std::wstring wprotocol(options.protocol.begin(), options.protocol.end());
+        const std::wstring wicon = wprotocol + L"\\DefaultIcon";
+        const std::wstring wcommand = wprotocol + L"\\shell\\open\\command";
+        const std::wstring wdescription = L"URL: " + wprotocol + L" Protocol";
 
-    const std::wstring wpath(path.begin(), path.end());
-    cmdkey.setStringValue(L"", L"\"" + wpath + L"\" %1");
+        WinReg::RegKey existing;
+        if (!existing.tryOpen(HKEY_CLASSES_ROOT, wprotocol, KEY_READ)) {
+            created.push_back(wprotocol);
+        }
+
+        written = write_keys({ wprotocol, wicon, wcommand, wdescription }, path, options.d, report);
+        if (!written) {
+            break;
+        }
+    }
 
-    if (options.d.has_value()) {
-        for (const auto& [key, value] : *options.d) {
-            const std::wstring wkey(key.begin(), key.end());
-            const std::wstring wvalue(value.begin(), value.end());
+    // Without it every key is written back lazily, one flush covers the hive for the whole transaction
+    if (written) {
+        if (const auto flushed = traced("RegKey::flushKey", [&] { return classes.tryFlushKey(); }); flushed.failed()) {
+            written = std::unexpected{ error{ std::error_code{ static_cast<int>(flushed.code()), std::system_category() }, "RegKey::flushKey" } };
+        }
+    }
 
-            cmdkey.setStringValue(wkey, wvalue);
+    if (!written) {
+        for (const auto& key : created) {
+            static_cast<void>(classes.tryDeleteTree(key));
+        }
+    }
+    static_cast<void>(classes.detach());
+
+    if (!written) {
+        return std::unexpected{ written.error() };
+    }
+#elif defined(__linux__) // Linux
+    std::error_code error;
+    const auto applications = detail::xdg::data_home(error) / "applications";
+    if (error) {
+        return failure(error, "locate the data directory");
+    }
+    const auto config = detail::xdg::config_home(error);
+    if (error) {
+        return failure(error, "locate the config directory");
+    }
+
+    if (std::filesystem::create_directories(applications, error); error) {
+        return failure(error, "create the applications directory");
+    }
+    if (std::filesystem::create_directories(config, error); error) {
+        return failure(error, "create the config directory");
+    }
+
+    // Later entries for the same scheme replace earlier ones
+    std::map<std::filesystem::path, std::string> files;
+    std::vector<std::pair<std::string, std::string>> handlers;
+    handlers.reserve(entries.size());
+
+    for (const auto& [path, options] : entries) {
+        // `add` validated every protocol
+        const std::string protocol = detail::lowercase_scheme(options.protocol);
+        std::string id = detail::xdg::desktop_id(protocol);
+
+        files.insert_or_assign(applications / id, detail::xdg::desktop_file(protocol, "URL: " + options.protocol + " Protocol", path, options.d));
+        handlers.emplace_back(detail::xdg::scheme_mime(protocol), std::move(id));
+    }
+
+    // Patched in place instead of running update-desktop-database, which re-reads every desktop file on the system.
+    // Without an existing cache the desktop reads the files directly, and a cache holding only these entries would hide the rest.
+    const auto cache = applications / "mimeinfo.cache";
+    if (const std::string content = detail::xdg::read_file(cache, error); error) {
+        return failure(error, "read mimeinfo.cache");
+    } else if (!content.empty()) {
+        DPLNK_TRACE_SPAN("patch mimeinfo.cache");
+        files.insert_or_assign(cache, detail::xdg::patch_mimeinfo_cache(content, handlers, applications));
+    }
+
+    {
+        DPLNK_TRACE_SPAN("update mimeapps.list");
+        const std::string content = detail::xdg::read_file(config / "mimeapps.list", error);
+        if (error) {
+            return failure(error, "read mimeapps.list");
+        }
+        files.insert_or_assign(config / "mimeapps.list", detail::xdg::set_default_handlers(content, handlers));
+    }
+
+    if (auto published = publish(files, report); !published) {
+        return std::unexpected{ published.error() };
+    }
+#else
+    return std::unexpected{ error{ std::make_error_code(std::errc::not_supported), "Unsupported platform!" } };
+#endif
+
+#if defined(_WIN32) || defined(__linux__)
+    entries.clear();
+    scheme_index::invalidate();
+
+    report.elapsed = std::chrono::steady_clock::now() - start;
+    return report;
+#endif
+}
+
+void dplnk::registration_transaction::commit() {
+    if (const auto committed = try_commit(); !committed) {
+        raise(committed.error());
+    }
+}
+
+void dplnk::detail::unregister_schemes(const std::vector<std::string>& protocols) {
+    if (protocols.empty()) {
+        return;
+    }
+    DPLNK_TRACE_SPAN("unregister_schemes");
+
+#ifdef _WIN32 // Windows
+    // Borrowed, the predefined handle is detached again instead of being closed
+    WinReg::RegKey classes{ HKEY_CLASSES_ROOT };
+    try {
+        for (const auto& protocol : protocols) {
+            const std::wstring wprotocol(protocol.begin(), protocol.end());
+            // Like the Linux branch, which only ever removes our own desktop files
+            if (!written_by_dplnk(wprotocol)) {
+                continue;
+            }
+
+            WinReg::RegResult result;
+            traced("RegKey::deleteTree protocol", [&] { result = classes.tryDeleteTree(wprotocol); });
+            if (result.failed() && result.code() != ERROR_FILE_NOT_FOUND) {
+                throw WinReg::RegException{ result.code(), "Cannot unregister '" + protocol + "': RegDeleteTreeW failed." };
+            }
+        }
+    } catch (...) {
+        static_cast<void>(classes.detach());
+        throw;
+    }
+    static_cast<void>(classes.detach());
+#elif defined(__linux__) // Linux
+    const auto applications = xdg::data_home() / "applications";
+
+    std::set<std::string, std::less<>> ids;
+    for (const auto& protocol : protocols) {
+        auto id = xdg::desktop_id(canonical_scheme(protocol));
+
+        std::error_code error;
+        std::filesystem::remove(applications / id, error);
+        if (error) {
+            throw std::system_error(error, "Cannot remove " + (applications / id).string());
+        }
+        // Dropped from the lists even when the file is already gone, stale entries are what this cleans up
+        ids.insert(std::move(id));
+    }
+
+    // One rewrite of each shared file for the whole batch
+    for (const auto& file : { applications / "mimeinfo.cache", xdg::config_home() / "mimeapps.list" }) {
+        const std::string content = xdg::read_file(file);
+        if (content.empty()) {
+            continue;
+        }
+
+        DPLNK_TRACE_SPAN("rewrite association list");
+        if (std::string updated = xdg::remove_handlers(content, ids); updated != content) {
+            xdg::write_file(file, updated);
+        }
+    }
+#else
+    throw std::runtime_error("Unsupported platform!");
+#endif
+
+    scheme_index::invalidate();
+}
+
+void dplnk::unregister(const std::string& protocol) {
+    if (!is_valid_scheme(protocol)) {
+        throw std::invalid_argument("Invalid protocol: '" + protocol + "' is not a valid URL scheme");
+    }
+
+    detail::unregister_schemes({ protocol });
+}
+
+void dplnk::unregister(const std::vector<std::string>& protocols) {
+    for (const auto& protocol : protocols) {
+        if (!is_valid_scheme(protocol)) {
+            throw std::invalid_argument("Invalid protocol: '" + protocol + "' is not a valid URL scheme");
+        }
+    }
+
+    detail::unregister_schemes(protocols);
+}
+
+std::size_t dplnk::unregister_all_for(const std::string& path) {
+    DPLNK_TRACE_SPAN("unregister_all_for");
+    std::vector<std::string> protocols;
+
+#ifdef _WIN32 // Windows
+    // One streaming pass over HKCR; keys are only deleted afterwards, deleting during the enumeration would shift its indices
+    for (const auto& [protocol, info] : scheme_index::build()) {
+        if (same_path(info.path, path)) {
+            protocols.push_back(protocol);
+        }
+    }
+#elif defined(__linux__) // Linux
+    // Our desktop files, including ones shadowed by another handler and so missing from the scheme index
+    std::error_code error;
+    for (std::filesystem::directory_iterator it{ detail::xdg::data_home() / "applications", error }, end; !error && it != end; it.increment(error)) {
+        const std::string name = it->path().filename().string();
+        if (!name.starts_with("dplnk-") || !name.ends_with(".desktop")) {
+            continue;
+        }
+
+        const detail::xdg::mapped_file mapped{ it->path() };
+        const auto entry = detail::xdg::parse_desktop_entry(mapped.view());
+        if (detail::xdg::exec_program(entry.exec) != path) {
+            continue;
+        }
+
+        for (const auto& mime : entry.mime_types) {
+            if (mime.starts_with("x-scheme-handler/")) {
+                protocols.push_back(mime.substr(std::string_view{ "x-scheme-handler/" }.size()));
+            }
         }
     }
 #else
     throw std::runtime_error("Unsupported platform!");
 #endif
-}
\ No newline at end of file
+
+    detail::unregister_schemes(protocols);
+    return protocols.size();
+}
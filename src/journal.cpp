@@ -0,0 +1,295 @@
+﻿#include "journal.h"
+
+#include "dispatcher.h"
+
+#include <algorithm>
+#include <bit>
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <limits>
+#include <stdexcept>
+#include <system_error>
+
+namespace {
+    // File: magic, wall clock at open in nanoseconds since the epoch, then records.
+    // Record: u32 size, u8 kind, u8 source, u16 zero, u64 time, u64 sequence, link, zero padding to 8 bytes.
+    constexpr char journal_magic[8] = { 'd', 'p', 'l', 'n', 'k', 'j', 'r', '1' };
+    constexpr std::size_t record_header = 24;
+
+    constexpr std::uint64_t padded(std::uint64_t size) noexcept {
+        return (size + 7) & ~std::uint64_t{ 7 };
+    }
+
+    // The first word doubles as the commit flag, records are never empty so it is never zero once written
+    constexpr std::uint64_t first_word(std::uint64_t size, dplnk::journal_record kind, dplnk::link_source source) noexcept {
+        return size | (static_cast<std::uint64_t>(kind) << 32) | (static_cast<std::uint64_t>(source) << 40);
+    }
+} // namespace
+
+dplnk::journal::journal(const std::filesystem::path& path, dplnk::journal_options options)
+    : capacity{ std::bit_ceil(std::max<std::size_t>(options.buffer, 4096)) }, opened{ std::chrono::steady_clock::now() }, interval{ options.flush_interval } {
+    ring = std::make_unique<std::uint64_t[]>(capacity / sizeof(std::uint64_t));
+
+#ifdef _WIN32 // Windows
+    file = _wfopen(path.c_str(), L"wb");
+#else // POSIX
+    file = std::fopen(path.c_str(), "wb");
+#endif
+    if (file == nullptr) {
+        throw std::system_error(errno, std::generic_category(), "Cannot open journal '" + path.string() + "'");
+    }
+
+    // Batches are already as large as writes get, a stdio buffer would only add a copy. Has to come before any write.
+    std::setvbuf(file, nullptr, _IONBF, 0);
+
+    const auto wall = static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count());
+    if (std::fwrite(journal_magic, 1, sizeof(journal_magic), file) != sizeof(journal_magic) || std::fwrite(&wall, 1, sizeof(wall), file) != sizeof(wall)) {
+        const int error = errno != 0 ? errno : EIO;
+        std::fclose(file);
+        throw std::system_error(error, std::generic_category(), "Cannot write journal '" + path.string() + "'");
+    }
+
+    // The destructor does not run for a constructor that throws, so the file is closed here
+    try {
+        writer = std::thread{ [this] { write(); } };
+    } catch (...) {
+        std::fclose(file);
+        throw;
+    }
+}
+
+dplnk::journal::~journal() {
+    {
+        std::lock_guard lock{ mutex };
+        stopping = true;
+    }
+    wake.notify_one();
+    writer.join();
+    std::fclose(file);
+}
+
+std::uint64_t dplnk::journal::received(std::string_view link, dplnk::link_source source) noexcept {
+    const std::uint64_t number = sequence.fetch_add(1, std::memory_order_relaxed) + 1;
+    record(journal_record::received, source, number, link);
+    return number;
+}
+
+void dplnk::journal::outcome(std::uint64_t number, dplnk::journal_record kind) noexcept {
+    record(kind, link_source::api, number, {});
+}
+
+void dplnk::journal::record(dplnk::journal_record kind, dplnk::link_source source, std::uint64_t number, std::string_view link) noexcept {
+    const std::uint64_t size = record_header + link.size();
+    const std::uint64_t needed = padded(size);
+    if (needed > capacity || size > (std::numeric_limits<std::uint32_t>::max)()) {
+        dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    // Reserve space with a CAS, so any number of threads can record without a lock
+    std::uint64_t at = reserved.load(std::memory_order_relaxed);
+    do {
+        if (at + needed - consumed.load(std::memory_order_acquire) > capacity) {
+            dropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+    } while (!reserved.compare_exchange_weak(at, at + needed, std::memory_order_relaxed));
+
+    // Only the record that crosses the halfway mark pays for a wake-up
+    const std::uint64_t filled = at + needed - consumed.load(std::memory_order_relaxed);
+    const bool crossed = filled >= capacity / 2 && filled - needed < capacity / 2;
+
+    auto* const storage = reinterpret_cast<std::byte*>(ring.get());
+    const auto copy_in = [&](std::uint64_t offset, const void* source, std::size_t count) {
+        const std::size_t begin = static_cast<std::size_t>(offset & (capacity - 1));
+        const std::size_t first = std::min(count, capacity - begin);
+        std::memcpy(storage + begin, source, first);
+        std::memcpy(storage, static_cast<const std::byte*>(source) + first, count - first);
+    };
+
+    const std::uint64_t body[2] = {
+        static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - opened).count()),
+        number,
+    };
+    copy_in(at + 8, body, sizeof(body));
+    copy_in(at + record_header, link.data(), link.size());
+
+    // Records are 8-byte aligned and the ring is a power of two, so the first word never wraps
+    std::atomic_ref<std::uint64_t>{ ring[(at & (capacity - 1)) / sizeof(std::uint64_t)] }.store(first_word(size, kind, source), std::memory_order_release);
+    recorded.fetch_add(1, std::memory_order_relaxed);
+
+    if (crossed) {
+        // Without taking the mutex a wake-up can be missed, which only delays the flush to the next interval
+        hurry.store(true, std::memory_order_relaxed);
+        wake.notify_one();
+    }
+}
+
+void dplnk::journal::flush(std::vector<std::byte>& batch) {
+    auto* const storage = reinterpret_cast<std::byte*>(ring.get());
+    std::uint64_t at = consumed.load(std::memory_order_relaxed);
+
+    batch.clear();
+    std::uint64_t records = 0;
+    while (true) {
+        const std::uint64_t first = std::atomic_ref<std::uint64_t>{ ring[(at & (capacity - 1)) / sizeof(std::uint64_t)] }.load(std::memory_order_acquire);
+        if (first == 0) {
+            break; // empty, or reserved but not yet committed
+        }
+
+        const std::uint64_t needed = padded(first & 0xffffffffu);
+        const std::size_t begin = static_cast<std::size_t>(at & (capacity - 1));
+        const std::size_t head = static_cast<std::size_t>(std::min<std::uint64_t>(needed, capacity - begin));
+
+        batch.insert(batch.end(), storage + begin, storage + begin + head);
+        batch.insert(batch.end(), storage, storage + (needed - head));
+
+        // Zeroed space reads as uncommitted when a later record lands on it
+        std::memset(storage + begin, 0, head);
+        std::memset(storage, 0, static_cast<std::size_t>(needed - head));
+        at += needed;
+        ++records;
+    }
+    consumed.store(at, std::memory_order_release);
+
+    if (batch.empty()) {
+        return;
+    }
+
+    // After a short write the file ends in a torn record, anything appended behind it could never be read back
+    if (failure.load(std::memory_order_relaxed) != 0) {
+        dropped.fetch_add(records, std::memory_order_relaxed);
+        return;
+    }
+
+    errno = 0;
+    if (std::fwrite(batch.data(), 1, batch.size(), file) != batch.size()) {
+        failure.store(errno != 0 ? errno : EIO, std::memory_order_relaxed);
+        dropped.fetch_add(records, std::memory_order_relaxed);
+        return;
+    }
+
+    bytes.fetch_add(batch.size(), std::memory_order_relaxed);
+    batches.fetch_add(1, std::memory_order_relaxed);
+}
+
+std::error_code dplnk::journal::error() const noexcept {
+    return { failure.load(std::memory_order_relaxed), std::generic_category() };
+}
+
+void dplnk::journal::write() {
+    std::vector<std::byte> batch;
+    batch.reserve(capacity);
+
+    while (true) {
+        {
+            std::unique_lock lock{ mutex };
+            wake.wait_for(lock, interval, [this] { return stopping || hurry.load(std::memory_order_relaxed); });
+            if (stopping) {
+                break;
+            }
+        }
+        hurry.store(false, std::memory_order_relaxed);
+        flush(batch);
+    }
+
+    // Whatever was recorded before the journal went away
+    flush(batch);
+}
+
+dplnk::journal_stats dplnk::journal::stats() const noexcept {
+    return {
+        recorded.load(std::memory_order_relaxed),
+        dropped.load(std::memory_order_relaxed),
+        bytes.load(std::memory_order_relaxed),
+        batches.load(std::memory_order_relaxed),
+    };
+}
+
+std::vector<dplnk::journal_entry> dplnk::read_journal(const std::filesystem::path& path) {
+    std::ifstream in{ path, std::ios::binary };
+    if (!in) {
+        throw std::runtime_error("Cannot open journal '" + path.string() + "'");
+    }
+
+    std::vector<char> content(static_cast<std::size_t>(std::filesystem::file_size(path)));
+    in.read(content.data(), static_cast<std::streamsize>(content.size()));
+    content.resize(static_cast<std::size_t>(in.gcount()));
+    if (content.size() < sizeof(journal_magic) + 8 || !std::equal(std::begin(journal_magic), std::end(journal_magic), content.begin())) {
+        throw std::runtime_error("'" + path.string() + "' is not a dplnk journal");
+    }
+
+    std::vector<journal_entry> entries;
+    std::size_t at = sizeof(journal_magic) + 8;
+
+    // A crash can leave a partial batch at the end, which is simply where reading stops
+    while (content.size() - at >= record_header) {
+        std::uint64_t first = 0;
+        std::uint64_t body[2] = {};
+        std::memcpy(&first, content.data() + at, sizeof(first));
+        std::memcpy(body, content.data() + at + 8, sizeof(body));
+
+        const std::uint64_t size = first & 0xffffffffu;
+        if (size < record_header || padded(size) > content.size() - at) {
+            break;
+        }
+
+        journal_entry& entry = entries.emplace_back();
+        entry.kind = static_cast<journal_record>((first >> 32) & 0xff);
+        entry.source = static_cast<link_source>((first >> 40) & 0xff);
+        entry.time = std::chrono::nanoseconds{ static_cast<std::int64_t>(body[0]) };
+        entry.sequence = body[1];
+        entry.link.assign(content.data() + at + record_header, static_cast<std::size_t>(size - record_header));
+
+        at += static_cast<std::size_t>(padded(size));
+    }
+
+    return entries;
+}
+
+std::size_t dplnk::replay(const std::filesystem::path& path, dplnk::dispatcher& dispatcher, dplnk::replay_options options) {
+    using clock = std::chrono::steady_clock;
+
+    const auto entries = read_journal(path);
+    const auto first = std::find_if(entries.begin(), entries.end(), [](const journal_entry& entry) { return entry.kind == journal_record::received; });
+    if (first == entries.end()) {
+        return 0;
+    }
+
+    const auto start = clock::now();
+    std::size_t count = 0;
+
+    for (auto it = first; it != entries.end(); ++it) {
+        if (it->kind != journal_record::received) {
+            continue;
+        }
+
+        if (options.speed > 0.0) {
+            const auto offset = std::chrono::duration<double, std::nano>{ static_cast<double>((it->time - first->time).count()) / options.speed };
+            const auto due = start + std::chrono::duration_cast<clock::duration>(offset);
+
+            // Keep main-thread handlers going while waiting, as a frame loop would
+            for (auto now = clock::now(); now < due; now = clock::now()) {
+                const auto slice = std::min<clock::duration>(options.frame_budget, due - now);
+                if (dispatcher.run(std::chrono::duration_cast<std::chrono::microseconds>(slice)) == 0) {
+                    std::this_thread::sleep_for(slice);
+                }
+            }
+        }
+
+        if (dispatcher.dispatch(it->link, link_source::replay)) {
+            ++count;
+        }
+    }
+
+    while (dispatcher.pending() > 0) {
+        dispatcher.run_deferred();
+        if (dispatcher.run(options.frame_budget) == 0) {
+            std::this_thread::yield();
+        }
+    }
+
+    return count;
+}
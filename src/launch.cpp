@@ -0,0 +1,139 @@
+﻿#include "launch.h"
+
+#include "link.h"
+#include "scheme.h"
+#include "trace.h"
+
+#include <stdexcept>
+#include <string>
+#include <system_error>
+
+#ifdef _WIN32 // Windows
+#include "subsystems/windows.h"
+
+#include <shellapi.h>
+#elif defined(__linux__) // Linux
+#include "lookup.h"
+#include "xdg.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <csignal>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <spawn.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace {
+    // Children no reaper thread could be started for, reaped on later launches instead
+    std::mutex children_mutex;
+    std::vector<pid_t> children;
+
+    // Handlers outlive the call, a detached thread blocks in waitpid so the child never lingers as a zombie
+    void reap(pid_t pid) {
+        try {
+            std::thread{ [pid] {
+                while (waitpid(pid, nullptr, 0) < 0 && errno == EINTR) {}
+            } }.detach();
+            return;
+        } catch (const std::system_error&) {
+        }
+
+        const std::lock_guard lock{ children_mutex };
+        std::erase_if(children, [](pid_t child) { return waitpid(child, nullptr, WNOHANG) != 0; });
+        children.push_back(pid);
+    }
+
+    // An errno value, 0 once the program is running (glibc reports a failed exec as the result)
+    int spawn(const std::vector<std::string>& arguments) {
+        std::vector<char*> argv;
+        argv.reserve(arguments.size() + 1);
+        for (const auto& argument : arguments) {
+            argv.push_back(const_cast<char*>(argument.c_str()));
+        }
+        argv.push_back(nullptr);
+
+        posix_spawnattr_t attributes;
+        if (const int error = posix_spawnattr_init(&attributes); error != 0) {
+            return error;
+        }
+
+        // The handler starts with default signal handling and an empty mask, whatever this process blocked or ignored,
+        // and in its own session so it does not go away with our terminal
+        sigset_t signals;
+        sigemptyset(&signals);
+        posix_spawnattr_setsigmask(&attributes, &signals);
+        sigfillset(&signals);
+        posix_spawnattr_setsigdefault(&attributes, &signals);
+
+        short flags = POSIX_SPAWN_SETSIGMASK | POSIX_SPAWN_SETSIGDEF;
+#ifdef POSIX_SPAWN_SETSID
+        flags |= POSIX_SPAWN_SETSID;
+#endif
+        posix_spawnattr_setflags(&attributes, flags);
+
+        pid_t pid = 0;
+        const int error = posix_spawnp(&pid, argv.front(), nullptr, &attributes, argv.data(), environ);
+        posix_spawnattr_destroy(&attributes);
+
+        if (error == 0) {
+            reap(pid);
+        }
+        return error;
+    }
+} // namespace
+#endif
+
+void dplnk::open(std::string_view url) {
+    DPLNK_TRACE_SPAN("open");
+
+    const std::string_view protocol = split_link(url).scheme;
+    if (!is_valid_scheme(protocol)) {
+        throw std::invalid_argument("Invalid link: '" + std::string{ url } + "' does not start with a valid URL scheme");
+    }
+
+#ifdef _WIN32 // Windows
+    const int length = MultiByteToWideChar(CP_UTF8, MB_ERR_INVALID_CHARS, url.data(), static_cast<int>(url.size()), nullptr, 0);
+    if (length == 0) {
+        throw std::system_error(static_cast<int>(GetLastError()), std::system_category(), "Invalid link: not UTF-8");
+    }
+
+    std::wstring wurl(static_cast<std::size_t>(length), L'\0');
+    MultiByteToWideChar(CP_UTF8, MB_ERR_INVALID_CHARS, url.data(), static_cast<int>(url.size()), wurl.data(), length);
+
+    SHELLEXECUTEINFOW info{};
+    info.cbSize = sizeof(info);
+    // Without NOASYNC the launch may still be in flight on this thread when the caller exits
+    info.fMask = SEE_MASK_NOASYNC | SEE_MASK_FLAG_NO_UI;
+    info.lpVerb = L"open";
+    info.lpFile = wurl.c_str();
+    info.nShow = SW_SHOWNORMAL;
+
+    if (!ShellExecuteExW(&info)) {
+        throw std::system_error(static_cast<int>(GetLastError()), std::system_category(), "ShellExecuteExW");
+    }
+#elif defined(__linux__) // Linux
+    const std::string link{ url };
+
+    {
+        DPLNK_TRACE_SPAN("resolve handler");
+        const auto index = scheme_index::current();
+        if (const registration_info* const info = index->find(protocol); info != nullptr) {
+            const auto arguments = detail::xdg::expand_field_codes(detail::xdg::split_exec(info->command), link);
+            if (!arguments.empty() && spawn(arguments) == 0) {
+                return;
+            }
+        }
+    }
+
+    DPLNK_TRACE_SPAN("xdg-open");
+    if (const int error = spawn({ "xdg-open", link }); error != 0) {
+        throw std::system_error(error, std::generic_category(), "Cannot open '" + link + "'");
+    }
+#else
+    throw std::runtime_error("Unsupported platform!");
+#endif
+}
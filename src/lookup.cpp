@@ -0,0 +1,306 @@
+﻿#include "lookup.h"
+
+#include "scheme.h"
+#include "trace.h"
+
+#include <algorithm>
+#include <mutex>
+
+#ifdef _WIN32 // Windows
+#include "subsystems/windows.h"
+#elif defined(__linux__) // Linux
+#include "xdg.hpp"
+
+#include <set>
+#endif
+
+namespace {
+    constexpr char lower(char c) noexcept {
+        return c >= 'A' && c <= 'Z' ? static_cast<char>(c - 'A' + 'a') : c;
+    }
+
+    std::mutex current_mutex;
+    std::shared_ptr<const dplnk::scheme_index> shared;
+
+#ifdef _WIN32 // Windows
+    std::string narrow(std::wstring_view text) {
+        if (text.empty()) {
+            return {};
+        }
+
+        const int size = WideCharToMultiByte(CP_UTF8, 0, text.data(), static_cast<int>(text.size()), nullptr, 0, nullptr, nullptr);
+        std::string narrowed(static_cast<std::size_t>(size), '\0');
+        WideCharToMultiByte(CP_UTF8, 0, text.data(), static_cast<int>(text.size()), narrowed.data(), size, nullptr, nullptr);
+        return narrowed;
+    }
+
+    // The program of a `shell\open\command` line, quoted or not
+    std::string command_path(std::string_view command) {
+        while (!command.empty() && command.front() == ' ') {
+            command.remove_prefix(1);
+        }
+        if (command.starts_with('"')) {
+            command.remove_prefix(1);
+            return std::string{ command.substr(0, command.find('"')) };
+        }
+        return std::string{ command.substr(0, command.find(' ')) };
+    }
+#elif defined(__linux__) // Linux
+    constexpr std::string_view scheme_prefix = "x-scheme-handler/";
+
+    struct handler_file {
+        dplnk::detail::xdg::desktop_entry entry;
+        std::string id;
+    };
+#endif
+} // namespace
+
+std::size_t dplnk::scheme_index::scheme_hash::operator()(std::string_view protocol) const noexcept {
+    std::uint64_t hash = 0xcbf29ce484222325ull;
+    for (const char c : protocol) {
+        hash ^= static_cast<unsigned char>(lower(c));
+        hash *= 0x100000001b3ull;
+    }
+    return static_cast<std::size_t>(hash);
+}
+
+bool dplnk::scheme_index::scheme_equal::operator()(std::string_view a, std::string_view b) const noexcept {
+    return a.size() == b.size() && std::equal(a.begin(), a.end(), b.begin(), [](char x, char y) { return lower(x) == lower(y); });
+}
+
+const dplnk::registration_info* dplnk::scheme_index::find(std::string_view protocol) const noexcept {
+    const auto it = entries.find(protocol);
+    return it != entries.end() ? &it->second : nullptr;
+}
+
+std::shared_ptr<const dplnk::scheme_index> dplnk::scheme_index::current() {
+    std::lock_guard lock{ current_mutex };
+    if (!shared) {
+        shared = std::make_shared<const scheme_index>(build());
+    }
+    return shared;
+}
+
+void dplnk::scheme_index::invalidate() noexcept {
+    std::shared_ptr<const scheme_index> stale;
+    {
+        std::lock_guard lock{ current_mutex };
+        stale.swap(shared);
+    }
+    // Readers holding the old snapshot keep it alive, the last one frees it outside the lock
+}
+
+std::optional<dplnk::registration_info> dplnk::query(std::string_view protocol) {
+    const auto index = scheme_index::current();
+    if (const registration_info* info = index->find(protocol)) {
+        return *info;
+    }
+    return std::nullopt;
+}
+
+#ifdef _WIN32 // Windows
+dplnk::scheme_index dplnk::scheme_index::build() {
+    DPLNK_TRACE_SPAN("build scheme index");
+    scheme_index index;
+
+    // Enumerated in place rather than through `enumSubKeys`, HKCR holds tens of thousands of keys
+    wchar_t name[256];
+    for (DWORD i = 0;; ++i) {
+        DWORD length = static_cast<DWORD>(std::size(name));
+        const LSTATUS status = RegEnumKeyExW(HKEY_CLASSES_ROOT, i, name, &length, nullptr, nullptr, nullptr, nullptr);
+        if (status == ERROR_NO_MORE_ITEMS) {
+            break;
+        }
+
+        // Extensions (`.txt`) and ProgIDs with dots or braces fail this without opening the key
+        const std::wstring_view key{ name, length };
+        if (status != ERROR_SUCCESS || !std::all_of(key.begin(), key.end(), [](wchar_t c) { return c < 0x80; })
+            || !is_valid_scheme(narrow(key))) {
+            continue;
+        }
+
+        WinReg::RegKey protocolkey;
+        if (!protocolkey.tryOpen(HKEY_CLASSES_ROOT, std::wstring{ key }, KEY_READ)) {
+            continue;
+        }
+
+        const auto marked = protocolkey.tryHasValue(L"URL Protocol");
+        if (!marked || !marked.getValue()) {
+            continue;
+        }
+
+        registration_info info;
+        info.protocol = narrow(key);
+        info.handler = info.protocol;
+
+        WinReg::RegKey cmdkey;
+        if (cmdkey.tryOpen(protocolkey.get(), L"shell\\open\\command", KEY_READ)) {
+            if (const auto values = cmdkey.tryEnumValues()) {
+                for (const auto& [value, type] : values.getValue()) {
+                    if (type != REG_SZ && type != REG_EXPAND_SZ) {
+                        continue;
+                    }
+
+                    const auto data = type == REG_SZ ? cmdkey.tryGetStringValue(value) : cmdkey.tryGetExpandStringValue(value);
+                    if (!data) {
+                        continue;
+                    }
+
+                    if (value.empty()) {
+                        info.command = narrow(data.getValue());
+                    } else {
+                        info.d.emplace(narrow(value), narrow(data.getValue()));
+                    }
+                }
+            }
+        }
+
+        info.path = command_path(info.command);
+        std::string protocol = info.protocol;
+        index.entries.insert_or_assign(std::move(protocol), std::move(info));
+    }
+
+    return index;
+}
+#elif defined(__linux__) // Linux
+dplnk::scheme_index dplnk::scheme_index::build() {
+    DPLNK_TRACE_SPAN("build scheme index");
+    namespace xdg = detail::xdg;
+
+    // Scheme entries of every mimeapps.list, highest precedence first
+    struct list_entries {
+        std::vector<std::pair<std::string, std::vector<std::string>>> defaults;
+        std::vector<std::pair<std::string, std::vector<std::string>>> added;
+        std::vector<std::pair<std::string, std::vector<std::string>>> removed;
+    };
+
+    std::vector<list_entries> lists;
+    std::set<std::string, std::less<>> referenced;
+
+    for (const auto& list : xdg::mimeapps_lists()) {
+        const xdg::mapped_file mapped{ list };
+        if (mapped.view().find(scheme_prefix) == std::string_view::npos) {
+            continue;
+        }
+
+        list_entries& entries = lists.emplace_back();
+        const auto collect = [&](std::string_view group, auto& into) {
+            for (const auto& [mime, value] : xdg::read_group(mapped.view(), group)) {
+                if (mime.starts_with(scheme_prefix)) {
+                    auto ids = xdg::split_list(value);
+                    referenced.insert(ids.begin(), ids.end());
+                    into.emplace_back(mime, std::move(ids));
+                }
+            }
+        };
+
+        collect("Default Applications", entries.defaults);
+        collect("Added Associations", entries.added);
+        collect("Removed Associations", entries.removed);
+    }
+
+    // Desktop files that declare a scheme or that a list names; the rest are skipped without being parsed
+    std::map<std::string, handler_file, std::less<>> installed;
+    std::vector<std::string> by_precedence;
+
+    xdg::for_each_desktop_file([&](const std::string& id, const std::filesystem::path& file) {
+        const xdg::mapped_file mapped{ file };
+        if (mapped.view().find(scheme_prefix) == std::string_view::npos && !referenced.contains(id)) {
+            return;
+        }
+
+        // Hidden entries are deleted, and since ids are visited once they also mask lower-precedence copies
+        auto entry = xdg::parse_desktop_entry(mapped.view());
+        if (entry.hidden || entry.exec.empty()) {
+            return;
+        }
+
+        by_precedence.push_back(id);
+        installed.emplace(id, handler_file{ std::move(entry), id });
+    });
+
+    // mime-apps spec: the first list naming an installed default wins. Added associations count in order,
+    // except where a list of higher precedence removed them; desktop files' own MimeType comes last.
+    std::map<std::string, std::string, std::less<>> defaults;
+    std::map<std::string, std::vector<std::string>, std::less<>> associations;
+    std::map<std::string, std::set<std::string, std::less<>>, std::less<>> removed;
+
+    for (const auto& entries : lists) {
+        for (const auto& [mime, ids] : entries.defaults) {
+            if (defaults.contains(mime)) {
+                continue;
+            }
+            const auto it = std::find_if(ids.begin(), ids.end(), [&](const std::string& id) { return installed.contains(id); });
+            if (it != ids.end()) {
+                defaults.emplace(mime, *it);
+            }
+        }
+
+        for (const auto& [mime, ids] : entries.added) {
+            auto& candidates = associations[mime];
+            for (const auto& id : ids) {
+                if (!removed[mime].contains(id)) {
+                    candidates.push_back(id);
+                }
+            }
+        }
+
+        for (const auto& [mime, ids] : entries.removed) {
+            removed[mime].insert(ids.begin(), ids.end());
+        }
+    }
+
+    for (const auto& id : by_precedence) {
+        for (const auto& mime : installed.at(id).entry.mime_types) {
+            if (mime.starts_with(scheme_prefix) && !removed[mime].contains(id)) {
+                associations[mime].push_back(id);
+            }
+        }
+    }
+
+    const auto resolve = [&](const std::string& mime) -> const handler_file* {
+        if (const auto it = defaults.find(mime); it != defaults.end()) {
+            return &installed.at(it->second);
+        }
+        for (const auto& id : associations[mime]) {
+            if (const auto it = installed.find(id); it != installed.end()) {
+                return &it->second;
+            }
+        }
+        return nullptr;
+    };
+
+    scheme_index index;
+    std::set<std::string, std::less<>> mimes;
+    for (const auto& [mime, id] : defaults) {
+        mimes.insert(mime);
+    }
+    for (const auto& [mime, candidates] : associations) {
+        mimes.insert(mime);
+    }
+
+    for (const auto& mime : mimes) {
+        const handler_file* const handler = resolve(mime);
+        if (handler == nullptr) {
+            continue;
+        }
+
+        registration_info info;
+        info.protocol = mime.substr(scheme_prefix.size());
+        info.command = handler->entry.exec;
+        info.handler = handler->id;
+        info.d = handler->entry.values;
+
+        info.path = xdg::exec_program(handler->entry.exec);
+
+        std::string protocol = info.protocol;
+        index.entries.insert_or_assign(std::move(protocol), std::move(info));
+    }
+
+    return index;
+}
+#else
+dplnk::scheme_index dplnk::scheme_index::build() {
+    return {};
+}
+#endif
@@ -0,0 +1,190 @@
+﻿#include "metrics.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <mutex>
+#include <vector>
+
+namespace {
+    // Ids of histograms still alive, so an exiting thread never touches the shards of a destroyed one
+    struct live_histograms {
+        std::mutex mutex;
+        std::vector<std::uint64_t> ids;
+        std::uint64_t next = 0;
+    };
+
+    live_histograms& live() {
+        // Leaked so threads exiting after static destruction can still use it
+        static auto* histograms = new live_histograms;
+        return *histograms;
+    }
+
+    template<typename Shards, typename Shard, typename Visit>
+    void for_each_shard(Shards& owned, Shard& shared, Visit visit) {
+        for (Shard& shard : owned) {
+            visit(shard);
+        }
+        visit(shared);
+    }
+
+    dplnk::histogram histograms[4];
+
+    constexpr std::string_view names[] = {
+        "dplnk_registration_seconds",
+        "dplnk_forward_seconds",
+        "dplnk_queue_seconds",
+        "dplnk_handler_seconds",
+    };
+
+    constexpr std::string_view help[] = {
+        "Time spent writing a scheme registration.",
+        "Time spent handing a link to a running or future instance.",
+        "Time from dispatch to the first step of a link's handler.",
+        "Duration of a single handler step.",
+    };
+} // namespace
+
+dplnk::detail::thread_shards::~thread_shards() {
+    auto& registry = live();
+    const std::lock_guard lock{ registry.mutex };
+    for (std::size_t i = 0; i < count; ++i) {
+        const auto [owner, shard] = owned[i];
+        if (shard != nullptr && std::ranges::find(registry.ids, owner) != registry.ids.end()) {
+            shard->claimed.store(false, std::memory_order_release);
+        }
+    }
+}
+
+dplnk::histogram::histogram() {
+    auto& registry = live();
+    const std::lock_guard lock{ registry.mutex };
+    id = registry.next++;
+    registry.ids.push_back(id);
+}
+
+dplnk::histogram::~histogram() {
+    auto& registry = live();
+    const std::lock_guard lock{ registry.mutex };
+    std::erase(registry.ids, id);
+}
+
+dplnk::detail::histogram_shard* dplnk::histogram::claim() noexcept {
+    auto& cache = detail::local_shards;
+    // Without room to remember a slot this thread could never hand it back
+    if (cache.count == cache.owned.size()) {
+        return nullptr;
+    }
+
+    detail::histogram_shard* claimed = nullptr;
+    for (auto& shard : owned) {
+        bool expected = false;
+        if (shard.claimed.compare_exchange_strong(expected, true, std::memory_order_acquire)) {
+            claimed = &shard;
+            break;
+        }
+    }
+
+    // Also remembered when every slot was taken, so later samples go straight to `shared`
+    cache.owned[cache.count++] = { id, claimed };
+    return claimed;
+}
+
+void dplnk::histogram::record_shared(std::uint64_t value) noexcept {
+    shared.counts[bucket_of(value)].fetch_add(1, std::memory_order_relaxed);
+    shared.sum.fetch_add(value, std::memory_order_relaxed);
+
+    std::uint64_t max = shared.max.load(std::memory_order_relaxed);
+    while (value > max && !shared.max.compare_exchange_weak(max, value, std::memory_order_relaxed)) {}
+
+    std::uint64_t min = shared.min.load(std::memory_order_relaxed);
+    while (value < min && !shared.min.compare_exchange_weak(min, value, std::memory_order_relaxed)) {}
+}
+
+std::chrono::nanoseconds dplnk::histogram_snapshot::mean() const noexcept {
+    return count == 0 ? std::chrono::nanoseconds{ 0 } : sum / static_cast<std::int64_t>(count);
+}
+
+std::chrono::nanoseconds dplnk::histogram_snapshot::percentile(double q) const noexcept {
+    if (count == 0) {
+        return std::chrono::nanoseconds{ 0 };
+    }
+
+    const auto rank = static_cast<std::uint64_t>(std::ceil(std::clamp(q, 0.0, 1.0) * static_cast<double>(count)));
+    std::uint64_t seen = 0;
+    for (std::size_t bucket = 0; bucket < buckets; ++bucket) {
+        seen += counts[bucket];
+        if (seen >= std::max<std::uint64_t>(rank, 1)) {
+            const auto upper = bucket + 1 < buckets ? histogram::bucket_floor(bucket + 1) - 1 : static_cast<std::uint64_t>(max.count());
+            return std::clamp(std::chrono::nanoseconds{ static_cast<std::int64_t>(upper) }, min, max);
+        }
+    }
+    return max;
+}
+
+dplnk::histogram_snapshot dplnk::histogram::snapshot() const noexcept {
+    histogram_snapshot merged;
+    std::uint64_t sum = 0;
+    std::uint64_t min = (std::numeric_limits<std::uint64_t>::max)();
+    std::uint64_t max = 0;
+
+    for_each_shard(owned, shared, [&](const detail::histogram_shard& shard) {
+        for (std::size_t bucket = 0; bucket < buckets; ++bucket) {
+            const std::uint64_t count = shard.counts[bucket].load(std::memory_order_relaxed);
+            merged.counts[bucket] += count;
+            merged.count += count;
+        }
+        sum += shard.sum.load(std::memory_order_relaxed);
+        min = std::min(min, shard.min.load(std::memory_order_relaxed));
+        max = std::max(max, shard.max.load(std::memory_order_relaxed));
+    });
+
+    merged.sum = std::chrono::nanoseconds{ static_cast<std::int64_t>(sum) };
+    merged.min = std::chrono::nanoseconds{ merged.count == 0 ? 0 : static_cast<std::int64_t>(min) };
+    merged.max = std::chrono::nanoseconds{ static_cast<std::int64_t>(max) };
+    return merged;
+}
+
+void dplnk::histogram::reset() noexcept {
+    for_each_shard(owned, shared, [](detail::histogram_shard& shard) {
+        for (auto& count : shard.counts) {
+            count.store(0, std::memory_order_relaxed);
+        }
+        shard.sum.store(0, std::memory_order_relaxed);
+        shard.max.store(0, std::memory_order_relaxed);
+        shard.min.store((std::numeric_limits<std::uint64_t>::max)(), std::memory_order_relaxed);
+    });
+}
+
+dplnk::histogram& dplnk::latency(dplnk::metric metric) noexcept {
+    return histograms[static_cast<std::size_t>(metric)];
+}
+
+std::string dplnk::export_metrics() {
+    constexpr double quantiles[] = { 0.5, 0.9, 0.99, 0.999 };
+
+    std::string text;
+    char line[160];
+
+    const auto seconds = [](std::chrono::nanoseconds value) { return std::chrono::duration<double>(value).count(); };
+
+    for (std::size_t i = 0; i < std::size(histograms); ++i) {
+        const histogram_snapshot snapshot = histograms[i].snapshot();
+        const auto name = names[i];
+
+        text.append("# HELP ").append(name).append(" ").append(help[i]).append("\n");
+        text.append("# TYPE ").append(name).append(" summary\n");
+
+        for (const double q : quantiles) {
+            std::snprintf(line, sizeof(line), "%.*s{quantile=\"%g\"} %.9g\n", static_cast<int>(name.size()), name.data(), q, seconds(snapshot.percentile(q)));
+            text.append(line);
+        }
+
+        std::snprintf(line, sizeof(line), "%.*s_sum %.9g\n", static_cast<int>(name.size()), name.data(), seconds(snapshot.sum));
+        text.append(line);
+        std::snprintf(line, sizeof(line), "%.*s_count %llu\n", static_cast<int>(name.size()), name.data(), static_cast<unsigned long long>(snapshot.count));
+        text.append(line);
+    }
+
+    return text;
+}
@@ -0,0 +1,400 @@
+﻿#include "presence.h"
+
+#include "scheme.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <system_error>
+
+#ifdef _WIN32 // Windows
+#include <Windows.h>
+#else // POSIX
+#include <cerrno>
+#include <csignal>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace dplnk::detail {
+    // Lives in memory shared between processes, so everything in it is a lock-free atomic
+    struct alignas(64) presence_slot {
+        std::atomic<std::uint32_t> sequence;
+        // The process inside the write side, zero when free: pid in the high half, low half of its start time below
+        std::atomic<std::uint64_t> writer;
+        std::atomic<std::uint32_t> pid;
+        std::atomic<std::uint64_t> start_time;
+        std::atomic<std::int64_t> heartbeat;
+        std::atomic<std::uint64_t> endpoint_size;
+        std::atomic<std::uint64_t> endpoint[sizeof(instance::endpoint_data) / sizeof(std::uint64_t)];
+    };
+
+    struct presence_layout {
+        std::atomic<std::uint32_t> version;
+        presence_slot slots[presence_table::slots];
+    };
+
+    static_assert(std::atomic<std::uint64_t>::is_always_lock_free && std::atomic<std::uint32_t>::is_always_lock_free,
+        "presence table atomics must be address-free to work across processes");
+} // namespace dplnk::detail
+
+namespace {
+    constexpr std::uint32_t layout_version = 2;
+    constexpr int write_attempts = 64;
+    constexpr int read_attempts = 64;
+
+    std::uint32_t current_pid() noexcept {
+#ifdef _WIN32 // Windows
+        return static_cast<std::uint32_t>(GetCurrentProcessId());
+#else // POSIX
+        return static_cast<std::uint32_t>(getpid());
+#endif
+    }
+
+    std::int64_t now() noexcept {
+        // steady_clock is system-wide (CLOCK_MONOTONIC, QueryPerformanceCounter), so heartbeats compare across processes
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    // Identifies a process beyond its pid, which the OS recycles. Empty if no such process is running.
+    std::optional<std::uint64_t> process_start_time(std::uint32_t pid) noexcept {
+#ifdef _WIN32 // Windows
+        const HANDLE process = OpenProcess(PROCESS_QUERY_LIMITED_INFORMATION, FALSE, pid);
+        if (process == nullptr) {
+            return std::nullopt;
+        }
+
+        FILETIME creation{}, exit{}, kernel{}, user{};
+        DWORD code = 0;
+        const bool running = GetExitCodeProcess(process, &code) && code == STILL_ACTIVE
+            && GetProcessTimes(process, &creation, &exit, &kernel, &user);
+        CloseHandle(process);
+
+        if (!running) {
+            return std::nullopt;
+        }
+        return (static_cast<std::uint64_t>(creation.dwHighDateTime) << 32) | creation.dwLowDateTime;
+#elif defined(__linux__) // Linux
+        char path[32];
+        std::snprintf(path, sizeof(path), "/proc/%u/stat", pid);
+
+        const int fd = open(path, O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+            return std::nullopt;
+        }
+
+        char stat[512];
+        const ssize_t size = read(fd, stat, sizeof(stat) - 1);
+        close(fd);
+        if (size <= 0) {
+            return std::nullopt;
+        }
+
+        // The command name may contain spaces and parentheses, fields are counted from its closing one
+        const std::string_view text{ stat, static_cast<std::size_t>(size) };
+        const std::size_t name_end = text.rfind(')');
+        if (name_end == std::string_view::npos) {
+            return std::nullopt;
+        }
+
+        // `starttime` is field 22, the 20th after the name
+        std::size_t at = name_end + 1;
+        for (int field = 0; field < 20; ++field) {
+            at = text.find(' ', at);
+            if (at == std::string_view::npos) {
+                return std::nullopt;
+            }
+            ++at;
+        }
+
+        // The state (field 3) follows the name, a zombie has exited already
+        if (name_end + 2 >= text.size() || text[name_end + 2] == 'Z' || at >= text.size()) {
+            return std::nullopt;
+        }
+
+        std::uint64_t start = 0;
+        for (; at < text.size() && text[at] >= '0' && text[at] <= '9'; ++at) {
+            start = start * 10 + static_cast<std::uint64_t>(text[at] - '0');
+        }
+        return start;
+#else // Other POSIX, only the pid can be checked
+        if (kill(static_cast<pid_t>(pid), 0) == 0 || errno == EPERM) {
+            return 0;
+        }
+        return std::nullopt;
+#endif
+    }
+
+    bool alive(std::uint32_t pid, std::uint64_t start_time) noexcept {
+        const auto start = process_start_time(pid);
+        return start.has_value() && *start == start_time;
+    }
+
+    std::uint64_t writer_id(std::uint32_t pid, std::uint64_t start_time) noexcept {
+        return (static_cast<std::uint64_t>(pid) << 32) | (start_time & 0xffffffffu);
+    }
+
+    bool writer_alive(std::uint64_t writer) noexcept {
+        const auto start = process_start_time(static_cast<std::uint32_t>(writer >> 32));
+        return start.has_value() && (*start & 0xffffffffu) == (writer & 0xffffffffu);
+    }
+
+    // Seqlock writer side. Writers exclude each other through `writer`, an odd sequence tells readers a write is in progress.
+    // A writer that died inside leaves both set; the next one to find its process gone takes the slot over.
+    class slot_writer {
+    public:
+        slot_writer(dplnk::detail::presence_slot& slot, std::uint64_t id) noexcept : slot{ slot } {
+            for (int attempt = 0; attempt < write_attempts; ++attempt) {
+                std::uint64_t holder = 0;
+                if (slot.writer.compare_exchange_weak(holder, id, std::memory_order_acquire)) {
+                    begin();
+                    return;
+                }
+            }
+
+            // Only a slot that stayed held pays for the process lookup
+            std::uint64_t holder = slot.writer.load(std::memory_order_relaxed);
+            if (holder != 0 && !writer_alive(holder) && slot.writer.compare_exchange_strong(holder, id, std::memory_order_acquire)) {
+                begin();
+            }
+        }
+
+        ~slot_writer() {
+            if (locked) {
+                slot.sequence.store(next, std::memory_order_release);
+                slot.writer.store(0, std::memory_order_release);
+            }
+        }
+
+        slot_writer(const slot_writer&) = delete;
+        slot_writer& operator=(const slot_writer&) = delete;
+
+        explicit operator bool() const noexcept { return locked; }
+
+    private:
+        void begin() noexcept {
+            // Already odd if the previous writer died between its two stores
+            const std::uint32_t sequence = slot.sequence.load(std::memory_order_relaxed);
+            slot.sequence.store(sequence | 1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+            next = (sequence | 1) + 1;
+            locked = true;
+        }
+
+        dplnk::detail::presence_slot& slot;
+        std::uint32_t next = 0;
+        bool locked = false;
+    };
+
+    void unmap(dplnk::detail::presence_layout* table, [[maybe_unused]] std::intptr_t handle) noexcept {
+#ifdef _WIN32 // Windows
+        UnmapViewOfFile(table);
+        CloseHandle(reinterpret_cast<HANDLE>(handle));
+#else // POSIX
+        // The name is left in place, other instances may still have the table mapped
+        munmap(table, sizeof(dplnk::detail::presence_layout));
+#endif
+    }
+
+    void store_endpoint(dplnk::detail::presence_slot& slot, std::string_view endpoint) noexcept {
+        for (std::size_t word = 0; word < std::size(slot.endpoint); ++word) {
+            std::uint64_t value = 0;
+            const std::size_t offset = word * sizeof(value);
+            if (offset < endpoint.size()) {
+                std::memcpy(&value, endpoint.data() + offset, (std::min)(sizeof(value), endpoint.size() - offset));
+            }
+            slot.endpoint[word].store(value, std::memory_order_relaxed);
+        }
+        slot.endpoint_size.store(endpoint.size(), std::memory_order_relaxed);
+    }
+} // namespace
+
+dplnk::presence_table::presence_table(std::string_view protocol) {
+    const std::string name = detail::canonical_scheme(protocol);
+
+#ifdef _WIN32 // Windows
+    // The Local namespace is per session, which matches where the registered handler gets launched
+    const std::wstring object = L"Local\\dplnk-" + std::wstring(name.begin(), name.end());
+
+    const HANDLE mapping = CreateFileMappingW(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE, 0, sizeof(detail::presence_layout), object.c_str());
+    if (mapping == nullptr) {
+        throw std::system_error(static_cast<int>(GetLastError()), std::system_category(), "CreateFileMappingW");
+    }
+
+    void* const view = MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, sizeof(detail::presence_layout));
+    if (view == nullptr) {
+        const DWORD error = GetLastError();
+        CloseHandle(mapping);
+        throw std::system_error(static_cast<int>(error), std::system_category(), "MapViewOfFile");
+    }
+
+    handle = reinterpret_cast<std::intptr_t>(mapping);
+#else // POSIX
+    // Shared memory names are global, the uid keeps users from seeing (or squatting on) each other's tables
+    const std::string object = "/dplnk-" + std::to_string(getuid()) + "-" + name;
+
+    const int fd = shm_open(object.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+    if (fd < 0) {
+        throw std::system_error(errno, std::generic_category(), "shm_open");
+    }
+
+    struct stat info {};
+    if (fstat(fd, &info) != 0 || (static_cast<std::size_t>(info.st_size) < sizeof(detail::presence_layout) && ftruncate(fd, sizeof(detail::presence_layout)) != 0)) {
+        const int error = errno;
+        close(fd);
+        throw std::system_error(error, std::generic_category(), "shm_open");
+    }
+
+    void* const view = mmap(nullptr, sizeof(detail::presence_layout), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    const int error = errno;
+    close(fd);
+    if (view == MAP_FAILED) {
+        throw std::system_error(error, std::generic_category(), "mmap");
+    }
+#endif
+
+    // New mappings are zero filled, which already is a valid empty table
+    table = static_cast<detail::presence_layout*>(view);
+    owner = writer_id(current_pid(), process_start_time(current_pid()).value_or(0));
+
+    std::uint32_t version = 0;
+    if (!table->version.compare_exchange_strong(version, layout_version) && version != layout_version) {
+        unmap(table, handle);
+        throw std::runtime_error("Incompatible presence table layout!");
+    }
+}
+
+dplnk::presence_table::~presence_table() {
+    if (table == nullptr) {
+        return;
+    }
+
+    withdraw();
+    unmap(table, handle);
+}
+
+bool dplnk::presence_table::read(std::size_t index, dplnk::instance& out) const noexcept {
+    const detail::presence_slot& slot = table->slots[index];
+
+    for (int attempt = 0; attempt < read_attempts; ++attempt) {
+        const std::uint32_t sequence = slot.sequence.load(std::memory_order_acquire);
+        if (sequence & 1) {
+            continue;
+        }
+
+        out.pid = slot.pid.load(std::memory_order_relaxed);
+        out.start_time = slot.start_time.load(std::memory_order_relaxed);
+        out.heartbeat = std::chrono::steady_clock::time_point{ std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+            std::chrono::nanoseconds{ slot.heartbeat.load(std::memory_order_relaxed) }) };
+        out.endpoint_size = (std::min)(static_cast<std::size_t>(slot.endpoint_size.load(std::memory_order_relaxed)), sizeof(out.endpoint_data));
+        for (std::size_t word = 0; word < std::size(slot.endpoint); ++word) {
+            const std::uint64_t value = slot.endpoint[word].load(std::memory_order_relaxed);
+            std::memcpy(out.endpoint_data + word * sizeof(value), &value, sizeof(value));
+        }
+
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (slot.sequence.load(std::memory_order_relaxed) == sequence) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+bool dplnk::presence_table::announce(std::string_view endpoint) {
+    if (endpoint.size() > sizeof(instance::endpoint_data)) {
+        throw std::length_error("Presence endpoint is too long!");
+    }
+
+    const std::uint32_t pid = current_pid();
+    const auto start_time = process_start_time(pid).value_or(0);
+
+    const auto fill = [&](detail::presence_slot& slot) {
+        slot.pid.store(pid, std::memory_order_relaxed);
+        slot.start_time.store(start_time, std::memory_order_relaxed);
+        slot.heartbeat.store(now(), std::memory_order_relaxed);
+        store_endpoint(slot, endpoint);
+    };
+
+    if (claimed < slots) {
+        if (slot_writer writer{ table->slots[claimed], owner }) {
+            fill(table->slots[claimed]);
+            return true;
+        }
+        return false;
+    }
+
+    for (std::size_t index = 0; index < slots; ++index) {
+        // A slot that cannot be read may have been left mid-write by a crashed writer, the writer side finds out
+        instance current;
+        if (read(index, current) && current.pid != 0 && alive(current.pid, current.start_time)) {
+            continue;
+        }
+
+        detail::presence_slot& slot = table->slots[index];
+        slot_writer writer{ slot, owner };
+        if (!writer) {
+            continue;
+        }
+
+        // Someone may have claimed the slot between the read and taking the writer side
+        const std::uint32_t holder = slot.pid.load(std::memory_order_relaxed);
+        if (holder != 0 && alive(holder, slot.start_time.load(std::memory_order_relaxed))) {
+            continue;
+        }
+
+        fill(slot);
+        claimed = index;
+        return true;
+    }
+
+    return false;
+}
+
+void dplnk::presence_table::heartbeat() noexcept {
+    if (claimed >= slots) {
+        return;
+    }
+
+    detail::presence_slot& slot = table->slots[claimed];
+    if (slot_writer writer{ slot, owner }) {
+        slot.heartbeat.store(now(), std::memory_order_relaxed);
+    }
+}
+
+void dplnk::presence_table::withdraw() noexcept {
+    if (claimed >= slots) {
+        return;
+    }
+
+    detail::presence_slot& slot = table->slots[claimed];
+    if (slot_writer writer{ slot, owner }) {
+        slot.pid.store(0, std::memory_order_relaxed);
+        slot.start_time.store(0, std::memory_order_relaxed);
+        slot.heartbeat.store(0, std::memory_order_relaxed);
+        store_endpoint(slot, {});
+    }
+    claimed = slots;
+}
+
+std::optional<dplnk::instance> dplnk::presence_table::find_live(std::chrono::milliseconds max_silence) const noexcept {
+    const auto cutoff = std::chrono::steady_clock::now() - max_silence;
+
+    for (std::size_t index = 0; index < slots; ++index) {
+        instance current;
+        if (!read(index, current) || current.pid == 0 || current.heartbeat < cutoff) {
+            continue;
+        }
+
+        // Only instances that look current pay for the process lookup
+        if (alive(current.pid, current.start_time)) {
+            return current;
+        }
+    }
+
+    return std::nullopt;
+}
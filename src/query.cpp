@@ -0,0 +1,96 @@
+﻿#include "query.h"
+
+#include "simd.hpp"
+
+#include <bit>
+#include <limits>
+
+namespace {
+    class indexer {
+    public:
+        explicit indexer(const dplnk::detail::query_index& index) noexcept : index{ index } {}
+
+        void equals(std::size_t at) noexcept {
+            if (separator == npos) {
+                separator = at;
+            }
+        }
+
+        void ampersand(std::size_t at) noexcept {
+            if (at > start) {
+                record(at);
+            }
+            start = at + 1;
+            separator = npos;
+        }
+
+        dplnk::detail::query_index_result finish(std::size_t size) noexcept {
+            if (size > start) {
+                record(size);
+            }
+            return { count, truncated };
+        }
+
+    private:
+        static constexpr std::size_t npos = static_cast<std::size_t>(-1);
+        static constexpr std::size_t limit = (std::numeric_limits<std::uint16_t>::max)();
+
+        void record(std::size_t end) noexcept {
+            if (count == index.capacity || end > limit) {
+                truncated = true;
+                return;
+            }
+
+            const std::size_t key_end = separator == npos ? end : separator;
+            const std::size_t value_start = separator == npos ? end : separator + 1;
+
+            index.key_offsets[count] = static_cast<std::uint16_t>(start);
+            index.key_lengths[count] = static_cast<std::uint16_t>(key_end - start);
+            index.value_offsets[count] = static_cast<std::uint16_t>(value_start);
+            index.value_lengths[count] = static_cast<std::uint16_t>(end - value_start);
+            ++count;
+        }
+
+        const dplnk::detail::query_index& index;
+        std::size_t start = 0;
+        std::size_t separator = npos;
+        std::size_t count = 0;
+        bool truncated = false;
+    };
+} // namespace
+
+dplnk::detail::query_index_result dplnk::detail::index_query(std::string_view query, const dplnk::detail::query_index& index) noexcept {
+    indexer indexer{ index };
+    std::size_t at = 0;
+
+#if defined(__SSE2__) || defined(_M_X64)
+    // Sixteen bytes at a time, visiting only the bytes that are `&` or `=`
+    const __m128i ampersands = _mm_set1_epi8('&');
+    const __m128i equals = _mm_set1_epi8('=');
+
+    for (; query.size() - at >= 16; at += 16) {
+        const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(query.data() + at));
+        const auto amp_mask = static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, ampersands)));
+        const auto eq_mask = static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, equals)));
+
+        for (unsigned mask = amp_mask | eq_mask; mask != 0; mask &= mask - 1) {
+            const unsigned bit = static_cast<unsigned>(std::countr_zero(mask));
+            if (amp_mask & (1u << bit)) {
+                indexer.ampersand(at + bit);
+            } else {
+                indexer.equals(at + bit);
+            }
+        }
+    }
+#endif
+
+    for (; at < query.size(); ++at) {
+        if (query[at] == '&') {
+            indexer.ampersand(at);
+        } else if (query[at] == '=') {
+            indexer.equals(at);
+        }
+    }
+
+    return indexer.finish(query.size());
+}
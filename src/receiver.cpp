@@ -0,0 +1,145 @@
+﻿#include "receiver.h"
+
+#include <algorithm>
+#include <bit>
+#include <stdexcept>
+
+namespace {
+    std::size_t slots(std::size_t requested) {
+        return std::bit_ceil(std::max<std::size_t>(requested, 1));
+    }
+
+    double refill(double tokens, double rate, double burst, std::chrono::duration<double> elapsed) noexcept {
+        return rate <= 0.0 ? burst : std::min(burst, tokens + elapsed.count() * rate);
+    }
+} // namespace
+
+dplnk::receiver::receiver(dplnk::receiver_options options)
+    : options{ options }, queue(options.capacity), recent(slots(options.dedupe_slots)), routes(slots(options.route_slots)),
+      total{ 0, options.total_burst, clock::time_point{}, 0 } {
+    if (options.capacity == 0) {
+        throw std::invalid_argument("receiver capacity must be at least one");
+    }
+}
+
+dplnk::push_result dplnk::receiver::push(std::string_view link) {
+    return push(link, clock::now());
+}
+
+dplnk::push_result dplnk::receiver::push(std::string_view link, clock::time_point now) {
+    const std::uint64_t hash = hash_link(link);
+    const std::uint64_t route = hash_link(route_of(link));
+
+    std::lock_guard lock{ mutex };
+    ++counters.received;
+
+    if (is_duplicate(hash, now)) {
+        ++counters.duplicates;
+        return push_result::duplicate;
+    }
+
+    bucket& bucket = routes[route & (routes.size() - 1)];
+    if (bucket.route != route) {
+        bucket = { route, options.route_burst, now, 0 };
+    }
+
+    if (!take_tokens(bucket, now)) {
+        ++counters.rate_limited;
+        return push_result::rate_limited;
+    }
+
+    if (tail - head == queue.size()) {
+        switch (options.overflow) {
+        case overflow_policy::drop_newest:
+            ++counters.dropped;
+            return push_result::dropped;
+
+        case overflow_policy::coalesce:
+            if (bucket.newest > head && queue[(bucket.newest - 1) % queue.size()].route == route) {
+                queue[(bucket.newest - 1) % queue.size()].link.assign(link);
+                remember(hash, now);
+                ++counters.coalesced;
+                return push_result::coalesced;
+            }
+            [[fallthrough]];
+
+        case overflow_policy::drop_oldest:
+            ++head;
+            ++counters.evicted;
+            break;
+        }
+    }
+
+    enqueue(link, route, bucket);
+    remember(hash, now);
+    return push_result::queued;
+}
+
+bool dplnk::receiver::pop(std::string& link) {
+    std::lock_guard lock{ mutex };
+
+    if (head == tail) {
+        return false;
+    }
+
+    // Swapping keeps both string buffers alive, so neither side reallocates in steady state
+    link.swap(queue[head % queue.size()].link);
+    ++head;
+    return true;
+}
+
+std::size_t dplnk::receiver::size() const {
+    std::lock_guard lock{ mutex };
+    return static_cast<std::size_t>(tail - head);
+}
+
+dplnk::receiver_stats dplnk::receiver::stats() const {
+    std::lock_guard lock{ mutex };
+    return counters;
+}
+
+bool dplnk::receiver::is_duplicate(std::uint64_t hash, clock::time_point now) const {
+    if (options.dedupe_window.count() <= 0) {
+        return false;
+    }
+
+    const seen& entry = recent[hash & (recent.size() - 1)];
+    return entry.hash == hash && now - entry.at < options.dedupe_window;
+}
+
+void dplnk::receiver::remember(std::uint64_t hash, clock::time_point now) {
+    if (options.dedupe_window.count() > 0) {
+        recent[hash & (recent.size() - 1)] = { hash, now };
+    }
+}
+
+bool dplnk::receiver::take_tokens(bucket& route, clock::time_point now) {
+    // Both buckets are refilled first and charged only if both have a token, so a link the total bucket rejects costs its route nothing
+    route.tokens = refill(route.tokens, options.route_rate, options.route_burst, now - route.refilled);
+    route.refilled = now;
+    total.tokens = refill(total.tokens, options.total_rate, options.total_burst, now - total.refilled);
+    total.refilled = now;
+
+    const bool limited = (options.route_rate > 0.0 && route.tokens < 1.0) || (options.total_rate > 0.0 && total.tokens < 1.0);
+    if (limited) {
+        return false;
+    }
+
+    if (options.route_rate > 0.0) {
+        route.tokens -= 1.0;
+    }
+    if (options.total_rate > 0.0) {
+        total.tokens -= 1.0;
+    }
+    return true;
+}
+
+void dplnk::receiver::enqueue(std::string_view link, std::uint64_t route, bucket& bucket) {
+    slot& slot = queue[tail % queue.size()];
+    slot.link.assign(link);
+    slot.route = route;
+
+    ++tail;
+    bucket.newest = tail;
+    ++counters.queued;
+}
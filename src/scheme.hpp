@@ -0,0 +1,26 @@
+#pragma once
+
+#include "scheme.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+namespace dplnk::detail {
+    // Schemes are case-insensitive, so names derived from them (files, shared memory) use the lowercase form.
+    // `protocol` has to pass `is_valid_scheme` already, this only allocates.
+    [[nodiscard]] inline std::string lowercase_scheme(std::string_view protocol) {
+        std::string name{ protocol };
+        std::transform(name.begin(), name.end(), name.begin(), [](char c) { return c >= 'A' && c <= 'Z' ? static_cast<char>(c - 'A' + 'a') : c; });
+        return name;
+    }
+
+    // `lowercase_scheme` for protocols nothing has validated yet
+    [[nodiscard]] inline std::string canonical_scheme(std::string_view protocol) {
+        if (!is_valid_scheme(protocol)) {
+            throw std::invalid_argument("Invalid protocol: '" + std::string{ protocol } + "' is not a valid URL scheme");
+        }
+        return lowercase_scheme(protocol);
+    }
+} // namespace dplnk::detail
@@ -0,0 +1,219 @@
+﻿#include "signature.h"
+#include "base64.h"
+#include "link.h"
+
+#include "sha256.hpp"
+
+#include <algorithm>
+
+namespace {
+    struct signed_parts {
+        std::string_view message;
+        std::string_view signature;
+        // From the `#` on, empty without a fragment
+        std::string_view fragment;
+    };
+
+    // Splits off the `sig=` parameter, which must be the last thing before the fragment
+    std::optional<signed_parts> split_signature(std::string_view link, std::string_view param) noexcept {
+        const auto hash = link.find('#');
+        const std::string_view fragment = hash == std::string_view::npos ? std::string_view{} : link.substr(hash);
+        link = link.substr(0, hash);
+
+        const auto at = link.find_last_of("?&");
+        if (at == std::string_view::npos) {
+            return std::nullopt;
+        }
+
+        const std::string_view rest = link.substr(at + 1);
+        if (rest.size() > param.size() && rest.starts_with(param) && rest[param.size()] == '=') {
+            return signed_parts{ link.substr(0, at), rest.substr(param.size() + 1), fragment };
+        }
+
+        return std::nullopt;
+    }
+
+    // Feeds `message` with its scheme lowercased, browsers do not preserve the case of schemes
+    void absorb(dplnk::detail::sha256& hash, std::string_view message) noexcept {
+        const auto colon = message.find(':');
+        const std::string_view scheme = colon == std::string_view::npos ? std::string_view{} : message.substr(0, colon);
+
+        char lowered[64];
+        for (std::size_t done = 0; done < scheme.size(); done += sizeof(lowered)) {
+            const std::size_t count = std::min(sizeof(lowered), scheme.size() - done);
+            for (std::size_t i = 0; i < count; ++i) {
+                const char c = scheme[done + i];
+                lowered[i] = (c >= 'A' && c <= 'Z') ? static_cast<char>(c - 'A' + 'a') : c;
+            }
+            hash.update(lowered, count);
+        }
+
+        message.remove_prefix(scheme.size());
+        hash.update(message.data(), message.size());
+    }
+} // namespace
+
+dplnk::link_verifier::link_verifier(dplnk::verifier_options options) : options{ std::move(options) } {}
+
+void dplnk::link_verifier::add_key(std::string key_id, std::span<const std::byte> secret) {
+    unsigned char block[64]{};
+
+    // RFC 2104: keys longer than the block are hashed first
+    if (secret.size() > sizeof(block)) {
+        unsigned char hashed[32];
+        detail::sha256 hash;
+        hash.update(secret.data(), secret.size());
+        hash.finish(hashed);
+        std::copy(std::begin(hashed), std::end(hashed), block);
+    } else {
+        std::transform(secret.begin(), secret.end(), block, [](std::byte b) { return static_cast<unsigned char>(b); });
+    }
+
+    unsigned char pad[64];
+
+    for (std::size_t i = 0; i < sizeof(pad); ++i) {
+        pad[i] = block[i] ^ 0x36;
+    }
+    detail::sha256 inner;
+    inner.update(pad, sizeof(pad));
+
+    for (std::size_t i = 0; i < sizeof(pad); ++i) {
+        pad[i] = block[i] ^ 0x5c;
+    }
+    detail::sha256 outer;
+    outer.update(pad, sizeof(pad));
+
+    key entry{ std::move(key_id), inner.midstate(), outer.midstate() };
+
+    const auto it = std::find_if(keys.begin(), keys.end(), [&](const key& key) { return key.id == entry.id; });
+    if (it != keys.end()) {
+        *it = std::move(entry);
+    } else {
+        keys.push_back(std::move(entry));
+    }
+}
+
+bool dplnk::link_verifier::remove_key(std::string_view key_id) {
+    return std::erase_if(keys, [&](const key& key) { return key.id == key_id; }) != 0;
+}
+
+const dplnk::link_verifier::key* dplnk::link_verifier::find(std::string_view key_id) const noexcept {
+    const auto it = std::find_if(keys.begin(), keys.end(), [&](const key& key) { return key.id == key_id; });
+    return it != keys.end() ? &*it : nullptr;
+}
+
+dplnk::link_verifier::digest dplnk::link_verifier::mac(const key& key, std::string_view message, std::string_view fragment) noexcept {
+    unsigned char inner_digest[32];
+    detail::sha256 inner{ key.inner, 64 };
+    absorb(inner, message);
+    inner.update(fragment.data(), fragment.size());
+    inner.finish(inner_digest);
+
+    unsigned char outer_digest[32];
+    detail::sha256 outer{ key.outer, 64 };
+    outer.update(inner_digest, sizeof(inner_digest));
+    outer.finish(outer_digest);
+
+    digest result;
+    std::transform(std::begin(outer_digest), std::end(outer_digest), result.begin(), [](unsigned char c) { return std::byte{ c }; });
+    return result;
+}
+
+dplnk::verify_result dplnk::link_verifier::verify(std::string_view link) const noexcept {
+    const auto parts = split_signature(link, options.signature_param);
+    if (!parts) {
+        return verify_result::unsigned_link;
+    }
+
+    if (parts->signature.find('&') != std::string_view::npos) {
+        return verify_result::malformed;
+    }
+
+    digest expected;
+    const auto decoded = base64url_decode(parts->signature, expected);
+    if (!decoded || *decoded != expected.size()) {
+        return verify_result::malformed;
+    }
+
+    const key* const key = find(find_param(split_link(parts->message).query, options.key_id_param).value_or(std::string_view{}));
+    if (key == nullptr) {
+        return verify_result::unknown_key;
+    }
+
+    const digest actual = mac(*key, parts->message, parts->fragment);
+
+    std::byte difference{ 0 };
+    for (std::size_t i = 0; i < actual.size(); ++i) {
+        difference |= actual[i] ^ expected[i];
+    }
+
+    return difference == std::byte{ 0 } ? verify_result::valid : verify_result::mismatch;
+}
+
+std::optional<std::string> dplnk::link_verifier::sign(std::string_view link, std::string_view key_id) const {
+    const key* const key = find(key_id);
+    if (key == nullptr) {
+        return std::nullopt;
+    }
+
+    // Both parameters go before the fragment, which is signed too
+    const auto hash = link.find('#');
+    const std::string_view fragment = hash == std::string_view::npos ? std::string_view{} : link.substr(hash);
+    link = link.substr(0, hash);
+
+    std::string message{ link };
+    if (!key_id.empty()) {
+        message += link.find('?') == std::string_view::npos ? '?' : '&';
+        message += options.key_id_param;
+        message += '=';
+        message += key_id;
+    }
+
+    const digest signature = mac(*key, message, fragment);
+
+    char encoded[base64url_encoded_size(std::tuple_size_v<digest>)];
+    const auto size = base64url_encode(signature, encoded);
+
+    message += message.find('?') == std::string::npos ? '?' : '&';
+    message += options.signature_param;
+    message += '=';
+    message.append(encoded, *size);
+    message += fragment;
+    return message;
+}
+
+std::array<std::byte, 32> dplnk::detail::hmac_sha256(std::span<const std::byte> secret, std::string_view message) noexcept {
+    unsigned char block[64]{};
+    if (secret.size() > sizeof(block)) {
+        unsigned char hashed[32];
+        detail::sha256 hash;
+        hash.update(secret.data(), secret.size());
+        hash.finish(hashed);
+        std::copy(std::begin(hashed), std::end(hashed), block);
+    } else {
+        std::transform(secret.begin(), secret.end(), block, [](std::byte b) { return static_cast<unsigned char>(b); });
+    }
+
+    unsigned char pad[64];
+    for (std::size_t i = 0; i < sizeof(pad); ++i) {
+        pad[i] = block[i] ^ 0x36;
+    }
+    unsigned char inner_digest[32];
+    detail::sha256 inner;
+    inner.update(pad, sizeof(pad));
+    inner.update(message.data(), message.size());
+    inner.finish(inner_digest);
+
+    for (std::size_t i = 0; i < sizeof(pad); ++i) {
+        pad[i] = block[i] ^ 0x5c;
+    }
+    unsigned char outer_digest[32];
+    detail::sha256 outer;
+    outer.update(pad, sizeof(pad));
+    outer.update(inner_digest, sizeof(inner_digest));
+    outer.finish(outer_digest);
+
+    std::array<std::byte, 32> result;
+    std::transform(std::begin(outer_digest), std::end(outer_digest), result.begin(), [](unsigned char c) { return std::byte{ c }; });
+    return result;
+}
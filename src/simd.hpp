@@ -0,0 +1,53 @@
+#pragma once
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define DPLNK_X86 1
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+// Lets a single translation unit carry kernels for instruction sets above the build's baseline
+#if defined(_MSC_VER) && !defined(__clang__)
+#define DPLNK_TARGET(isa)
+#else
+#define DPLNK_TARGET(isa) __attribute__((target(isa)))
+#endif
+
+namespace dplnk::detail {
+    struct cpu_features {
+        bool sse2 = false;
+        bool ssse3 = false;
+        bool avx2 = false;
+    };
+
+    // Detected once, then a plain load on every call
+    [[nodiscard]] inline const cpu_features& cpu() noexcept {
+        static const cpu_features features = [] {
+            cpu_features detected;
+#ifdef DPLNK_X86
+#if defined(_MSC_VER) && !defined(__clang__)
+            int info[4];
+            __cpuid(info, 1);
+            detected.sse2 = (info[3] & (1 << 26)) != 0;
+            detected.ssse3 = (info[2] & (1 << 9)) != 0;
+
+            const bool osxsave = (info[2] & (1 << 27)) != 0;
+            const bool avx = (info[2] & (1 << 28)) != 0;
+
+            __cpuidex(info, 7, 0);
+            detected.avx2 = osxsave && avx && (info[1] & (1 << 5)) != 0 && (_xgetbv(0) & 0x6) == 0x6;
+#else
+            __builtin_cpu_init();
+            detected.sse2 = __builtin_cpu_supports("sse2");
+            detected.ssse3 = __builtin_cpu_supports("ssse3");
+            detected.avx2 = __builtin_cpu_supports("avx2");
+#endif
+#endif
+            return detected;
+        }();
+
+        return features;
+    }
+} // namespace dplnk::detail
@@ -0,0 +1,433 @@
+﻿#include "spool.h"
+
+#include "metrics.h"
+#include "presence.h"
+#include "scheme.hpp"
+#include "trace.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <optional>
+#include <stdexcept>
+#include <system_error>
+
+#ifdef _WIN32 // Windows
+#include <Windows.h>
+#else // POSIX
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace dplnk::detail {
+    // Mapped by every process using the spool; `head` and `tail` only change under the file lock
+    struct spool_header {
+        std::atomic<std::uint32_t> magic;
+        std::atomic<std::uint32_t> version;
+        std::atomic<std::uint64_t> head;
+        std::atomic<std::uint64_t> tail;
+        std::uint64_t reserved[5];
+    };
+
+    static_assert(sizeof(spool_header) == 64);
+    static_assert(std::atomic<std::uint64_t>::is_always_lock_free, "spool offsets must be address-free to work across processes");
+} // namespace dplnk::detail
+
+namespace {
+    constexpr std::uint32_t spool_magic = 0x6b6e6c64; // "dlnk"
+    constexpr std::uint32_t spool_version = 1;
+    constexpr std::size_t first_record = sizeof(dplnk::detail::spool_header);
+
+    // Precedes every link. A record with a size of zero terminates the log.
+    struct record {
+        std::uint64_t check;
+        std::uint32_t size;
+        std::uint32_t reserved;
+    };
+
+    constexpr std::size_t record_bytes(std::size_t size) noexcept {
+        return sizeof(record) + ((size + 7) & ~std::size_t{ 7 });
+    }
+
+    constexpr std::uint64_t checksum(std::string_view link) noexcept {
+        return dplnk::hash_link(link) ^ link.size();
+    }
+
+    // Empty if the record at `offset` is a terminator, torn or does not end before `limit`
+    std::optional<std::string_view> read_record(const std::byte* data, std::uint64_t offset, std::uint64_t limit) noexcept {
+        if (offset + sizeof(record) > limit) {
+            return std::nullopt;
+        }
+
+        record header;
+        std::memcpy(&header, data + offset, sizeof(header));
+        if (header.size == 0 || offset + record_bytes(header.size) > limit) {
+            return std::nullopt;
+        }
+
+        const std::string_view link{ reinterpret_cast<const char*>(data + offset + sizeof(record)), header.size };
+        if (checksum(link) != header.check) {
+            return std::nullopt;
+        }
+        return link;
+    }
+
+    void terminate(std::byte* data, std::uint64_t offset) noexcept {
+        std::memset(data + offset, 0, sizeof(record));
+    }
+
+    // Serializes every process using the spool
+    class file_lock {
+    public:
+        explicit file_lock(std::intptr_t file) : file{ file } {
+#ifdef _WIN32 // Windows
+            OVERLAPPED overlapped{};
+            if (!LockFileEx(reinterpret_cast<HANDLE>(file), LOCKFILE_EXCLUSIVE_LOCK, 0, 1, 0, &overlapped)) {
+                throw std::system_error(static_cast<int>(GetLastError()), std::system_category(), "LockFileEx");
+            }
+#else // POSIX
+            while (flock(static_cast<int>(file), LOCK_EX) != 0) {
+                if (errno != EINTR) {
+                    throw std::system_error(errno, std::generic_category(), "flock");
+                }
+            }
+#endif
+        }
+
+        ~file_lock() {
+#ifdef _WIN32 // Windows
+            OVERLAPPED overlapped{};
+            UnlockFileEx(reinterpret_cast<HANDLE>(file), 0, 1, 0, &overlapped);
+#else // POSIX
+            flock(static_cast<int>(file), LOCK_UN);
+#endif
+        }
+
+        file_lock(const file_lock&) = delete;
+        file_lock& operator=(const file_lock&) = delete;
+
+    private:
+        std::intptr_t file;
+    };
+} // namespace
+
+std::filesystem::path dplnk::link_spool::default_path(std::string_view protocol) {
+    const std::string name = detail::canonical_scheme(protocol) + ".spool";
+
+#ifdef _WIN32 // Windows
+    wchar_t buffer[MAX_PATH];
+    const DWORD length = GetEnvironmentVariableW(L"LOCALAPPDATA", buffer, MAX_PATH);
+    if (length == 0 || length >= MAX_PATH) {
+        throw std::runtime_error("Cannot locate the local application data directory!");
+    }
+    return std::filesystem::path{ buffer } / "dplnk" / name;
+#else // POSIX
+    // The XDG base directory spec only accepts absolute paths
+    if (const char* state = std::getenv("XDG_STATE_HOME"); state != nullptr && state[0] == '/') {
+        return std::filesystem::path{ state } / "dplnk" / name;
+    }
+    if (const char* home = std::getenv("HOME"); home != nullptr && home[0] != '\0') {
+        return std::filesystem::path{ home } / ".local" / "state" / "dplnk" / name;
+    }
+    throw std::runtime_error("Cannot locate the user's state directory!");
+#endif
+}
+
+dplnk::link_spool::link_spool(std::string_view protocol, dplnk::spool_options options) {
+    const std::filesystem::path path = options.file.empty() ? default_path(protocol) : options.file;
+    if (options.capacity < first_record + 2 * record_bytes(1)) {
+        throw std::invalid_argument("spool capacity is too small");
+    }
+
+    std::filesystem::create_directories(path.parent_path());
+
+#ifdef _WIN32 // Windows
+    const HANDLE handle = CreateFileW(path.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+        nullptr, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (handle == INVALID_HANDLE_VALUE) {
+        throw std::system_error(static_cast<int>(GetLastError()), std::system_category(), "CreateFileW");
+    }
+    file = reinterpret_cast<std::intptr_t>(handle);
+#else // POSIX
+    const int fd = open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+    if (fd < 0) {
+        throw std::system_error(errno, std::generic_category(), "open");
+    }
+    file = fd;
+#endif
+
+    try {
+        // Held while sizing and mapping, so a concurrent creator never sees a half-initialized file
+        file_lock lock{ file };
+
+#ifdef _WIN32 // Windows
+        LARGE_INTEGER existing{};
+        if (!GetFileSizeEx(handle, &existing)) {
+            throw std::system_error(static_cast<int>(GetLastError()), std::system_category(), "GetFileSizeEx");
+        }
+        size = static_cast<std::size_t>(existing.QuadPart) >= first_record ? static_cast<std::size_t>(existing.QuadPart) : options.capacity;
+
+        // Mapping a file past its end grows it to the mapping's size
+        const HANDLE section = CreateFileMappingW(handle, nullptr, PAGE_READWRITE,
+            static_cast<DWORD>(static_cast<std::uint64_t>(size) >> 32), static_cast<DWORD>(size), nullptr);
+        if (section == nullptr) {
+            throw std::system_error(static_cast<int>(GetLastError()), std::system_category(), "CreateFileMappingW");
+        }
+        mapping = reinterpret_cast<std::intptr_t>(section);
+
+        void* const view = MapViewOfFile(section, FILE_MAP_ALL_ACCESS, 0, 0, size);
+        if (view == nullptr) {
+            throw std::system_error(static_cast<int>(GetLastError()), std::system_category(), "MapViewOfFile");
+        }
+#else // POSIX
+        struct stat info {};
+        if (fstat(fd, &info) != 0) {
+            throw std::system_error(errno, std::generic_category(), "fstat");
+        }
+
+        size = static_cast<std::size_t>(info.st_size) >= first_record ? static_cast<std::size_t>(info.st_size) : options.capacity;
+        if (static_cast<std::size_t>(info.st_size) != size && ftruncate(fd, static_cast<off_t>(size)) != 0) {
+            throw std::system_error(errno, std::generic_category(), "ftruncate");
+        }
+
+        void* const view = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (view == MAP_FAILED) {
+            throw std::system_error(errno, std::generic_category(), "mmap");
+        }
+#endif
+
+        data = static_cast<std::byte*>(view);
+        header = reinterpret_cast<detail::spool_header*>(data);
+        recover();
+    } catch (...) {
+        close();
+        throw;
+    }
+}
+
+dplnk::link_spool::~link_spool() {
+    close();
+}
+
+void dplnk::link_spool::close() noexcept {
+#ifdef _WIN32 // Windows
+    if (data != nullptr) {
+        UnmapViewOfFile(data);
+    }
+    if (mapping != -1) {
+        CloseHandle(reinterpret_cast<HANDLE>(mapping));
+    }
+    if (file != -1) {
+        CloseHandle(reinterpret_cast<HANDLE>(file));
+    }
+#else // POSIX
+    if (data != nullptr) {
+        munmap(data, size);
+    }
+    if (file != -1) {
+        ::close(static_cast<int>(file));
+    }
+#endif
+
+    data = nullptr;
+    header = nullptr;
+    mapping = -1;
+    file = -1;
+}
+
+void dplnk::link_spool::recover() {
+    const std::uint64_t head = header->head.load(std::memory_order_relaxed);
+    const std::uint64_t tail = header->tail.load(std::memory_order_relaxed);
+
+    const bool valid = header->magic.load(std::memory_order_relaxed) == spool_magic
+        && header->version.load(std::memory_order_relaxed) == spool_version
+        && head >= first_record && head <= tail && tail + sizeof(record) <= size;
+
+    if (!valid) {
+        terminate(data, first_record);
+        header->head.store(first_record, std::memory_order_relaxed);
+        header->tail.store(first_record, std::memory_order_relaxed);
+        header->version.store(spool_version, std::memory_order_relaxed);
+        header->magic.store(spool_magic, std::memory_order_release);
+        return;
+    }
+
+    // The stored tail is only a hint, the records themselves say how far the log got before a crash
+    std::uint64_t end = head;
+    while (const auto link = read_record(data, end, size - sizeof(record))) {
+        end += record_bytes(link->size());
+    }
+
+    if (end != tail) {
+        if (end < tail) {
+            ++counters.corrupt;
+        }
+        terminate(data, end);
+        header->tail.store(end, std::memory_order_release);
+    }
+}
+
+void dplnk::link_spool::sync(std::size_t offset, std::size_t bytes) const noexcept {
+#ifdef _WIN32 // Windows
+    FlushViewOfFile(data + offset, bytes);
+    FlushFileBuffers(reinterpret_cast<HANDLE>(file));
+#else // POSIX
+    // msync wants a page-aligned start
+    const auto page = static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+    const std::size_t begin = offset & ~(page - 1);
+    msync(data + begin, offset + bytes - begin, MS_SYNC);
+#endif
+}
+
+bool dplnk::link_spool::compact(bool durable) {
+    const std::uint64_t head = header->head.load(std::memory_order_relaxed);
+    const std::uint64_t tail = header->tail.load(std::memory_order_relaxed);
+    const std::uint64_t live = tail - head;
+
+    if (head == first_record) {
+        return false;
+    }
+
+    // An overlapping move could tear records that are still pending, that space is better left until the next drain
+    if (live > head - first_record) {
+        return false;
+    }
+
+    std::memcpy(data + first_record, data + head, live);
+    terminate(data, first_record + live);
+    if (durable) {
+        sync(first_record, live + sizeof(record));
+    }
+
+    header->head.store(first_record, std::memory_order_relaxed);
+    header->tail.store(first_record + live, std::memory_order_release);
+    if (durable) {
+        sync(0, sizeof(detail::spool_header));
+    }
+
+    ++counters.compactions;
+    return true;
+}
+
+bool dplnk::link_spool::append(std::string_view link, bool durable) {
+    DPLNK_TRACE_SPAN("spool append");
+    const std::size_t bytes = record_bytes(link.size());
+
+    std::lock_guard guard{ mutex };
+    if (link.empty() || link.size() > (std::numeric_limits<std::uint32_t>::max)() || first_record + bytes + sizeof(record) > size) {
+        ++counters.rejected;
+        return false;
+    }
+
+    file_lock lock{ file };
+
+    std::uint64_t tail = header->tail.load(std::memory_order_relaxed);
+    if (tail + bytes + sizeof(record) > size) {
+        if (!compact(durable) || (tail = header->tail.load(std::memory_order_relaxed)) + bytes + sizeof(record) > size) {
+            ++counters.rejected;
+            return false;
+        }
+    }
+
+    // The size goes in last: until then the record still reads as the terminator it replaces
+    std::memcpy(data + tail + sizeof(record), link.data(), link.size());
+    terminate(data, tail + bytes);
+
+    const record entry{ checksum(link), static_cast<std::uint32_t>(link.size()), 0 };
+    std::memcpy(data + tail, &entry, sizeof(entry));
+
+    if (durable) {
+        sync(static_cast<std::size_t>(tail), bytes + sizeof(record));
+    }
+
+    header->tail.store(tail + bytes, std::memory_order_release);
+    if (durable) {
+        sync(0, sizeof(detail::spool_header));
+    }
+
+    ++counters.appended;
+    return true;
+}
+
+std::size_t dplnk::link_spool::drain(dplnk::receiver& receiver) {
+    if (empty()) {
+        return 0;
+    }
+
+    DPLNK_TRACE_SPAN("spool drain");
+
+    std::lock_guard guard{ mutex };
+    file_lock lock{ file };
+
+    std::uint64_t head = header->head.load(std::memory_order_relaxed);
+    const std::uint64_t tail = header->tail.load(std::memory_order_relaxed);
+
+    std::size_t count = 0;
+    while (head < tail) {
+        const auto link = read_record(data, head, tail);
+        if (!link) {
+            // Nothing after a damaged record can be trusted to be aligned to a record
+            ++counters.corrupt;
+            head = tail;
+            break;
+        }
+
+        // A full queue would evict a link drained earlier in this loop
+        if (receiver.size() >= receiver.capacity()) {
+            break;
+        }
+
+        // A duplicate was already delivered, anything rejected stays in the spool for the next drain
+        const push_result result = receiver.push(*link);
+        if (result == push_result::rate_limited || result == push_result::dropped) {
+            break;
+        }
+
+        head += record_bytes(link->size());
+        if (result != push_result::duplicate) {
+            ++count;
+        }
+    }
+
+    if (head == tail && head != first_record) {
+        // Fully drained, so the next append starts over at the front of the file
+        terminate(data, first_record);
+        header->tail.store(first_record, std::memory_order_relaxed);
+        header->head.store(first_record, std::memory_order_release);
+        ++counters.compactions;
+    } else {
+        header->head.store(head, std::memory_order_release);
+    }
+
+    counters.drained += count;
+    return count;
+}
+
+bool dplnk::link_spool::empty() const noexcept {
+    return header->head.load(std::memory_order_acquire) == header->tail.load(std::memory_order_acquire);
+}
+
+dplnk::spool_stats dplnk::link_spool::stats() const {
+    std::lock_guard guard{ mutex };
+    return counters;
+}
+
+dplnk::forward_result dplnk::forward(std::string_view protocol, std::string_view link) {
+    const scoped_latency timer{ metric::forward };
+    DPLNK_TRACE_LINK_SPAN("forward", hash_link(link));
+    DPLNK_TRACE_FLOW_BEGIN("link", hash_link(link));
+
+    // Only worth paying for the sync when nobody is running to pick the link up right away
+    const bool live = presence_table{ protocol }.find_live().has_value();
+
+    link_spool spool{ protocol };
+    if (!spool.append(link, !live)) {
+        return forward_result::dropped;
+    }
+    return live ? forward_result::forwarded : forward_result::spooled;
+}
@@ -0,0 +1,168 @@
+﻿#include "trace.h"
+
+#include <array>
+#include <atomic>
+#include <cinttypes>
+#include <cstdio>
+#include <memory>
+
+#ifdef _WIN32 // Windows
+#include <Windows.h>
+#elif defined(__linux__) // Linux
+#include <sys/syscall.h>
+#include <unistd.h>
+#else // POSIX
+#include <pthread.h>
+#include <unistd.h>
+#endif
+
+namespace {
+    constexpr std::size_t ring_size = 8192;
+
+    // Written without locks: a slot's sequence is zero while it is being filled and the event's index + 1 once
+    // it is complete, so the exporter can skip slots that are mid-write or were overwritten while it read them.
+    struct slot {
+        std::atomic<std::uint64_t> sequence{ 0 };
+        std::atomic<const char*> name{ nullptr };
+        std::atomic<std::uint64_t> link{ 0 };
+        std::atomic<std::int64_t> start{ 0 };
+        std::atomic<std::int64_t> end{ 0 };
+        std::atomic<std::uint32_t> thread{ 0 };
+        std::atomic<dplnk::detail::trace_phase> phase{ dplnk::detail::trace_phase::complete };
+    };
+
+    struct ring {
+        std::atomic<std::uint64_t> next{ 0 };
+        std::array<slot, ring_size> slots;
+    };
+
+    // Allocated by the first event; without DPLNK_ENABLE_TRACING nothing records one and the exporter never looks
+    ring& events() {
+        static const auto instance = std::make_unique<ring>();
+        return *instance;
+    }
+
+    std::uint32_t current_thread() noexcept {
+        thread_local const std::uint32_t id = [] {
+#ifdef _WIN32 // Windows
+            return static_cast<std::uint32_t>(GetCurrentThreadId());
+#elif defined(__linux__) // Linux
+            return static_cast<std::uint32_t>(syscall(SYS_gettid));
+#else // POSIX
+            return static_cast<std::uint32_t>(reinterpret_cast<std::uintptr_t>(pthread_self()));
+#endif
+        }();
+        return id;
+    }
+
+#ifdef DPLNK_ENABLE_TRACING
+    std::uint32_t current_process() noexcept {
+#ifdef _WIN32 // Windows
+        return static_cast<std::uint32_t>(GetCurrentProcessId());
+#else // POSIX
+        return static_cast<std::uint32_t>(getpid());
+#endif
+    }
+#endif
+
+    std::int64_t nanoseconds(std::chrono::steady_clock::time_point time) noexcept {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(time.time_since_epoch()).count();
+    }
+} // namespace
+
+void dplnk::detail::trace(dplnk::detail::trace_phase phase, const char* name, std::uint64_t link, std::chrono::steady_clock::time_point start, std::chrono::steady_clock::time_point end) noexcept {
+    ring& ring = events();
+    const std::uint64_t index = ring.next.fetch_add(1, std::memory_order_relaxed);
+    slot& slot = ring.slots[index % ring_size];
+
+    slot.sequence.store(0, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    slot.name.store(name, std::memory_order_relaxed);
+    slot.link.store(link, std::memory_order_relaxed);
+    slot.start.store(nanoseconds(start), std::memory_order_relaxed);
+    slot.end.store(nanoseconds(end), std::memory_order_relaxed);
+    slot.thread.store(current_thread(), std::memory_order_relaxed);
+    slot.phase.store(phase, std::memory_order_relaxed);
+
+    slot.sequence.store(index + 1, std::memory_order_release);
+}
+
+std::string dplnk::export_trace() {
+#ifndef DPLNK_ENABLE_TRACING
+    return "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[]}";
+#else
+    ring& ring = events();
+    const std::uint64_t newest = ring.next.load(std::memory_order_acquire);
+    const std::uint64_t oldest = newest > ring_size ? newest - ring_size : 0;
+    const std::uint32_t pid = current_process();
+
+    std::string json = "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+    char event[320];
+    bool first = true;
+
+    for (std::uint64_t index = oldest; index < newest; ++index) {
+        const slot& slot = ring.slots[index % ring_size];
+        if (slot.sequence.load(std::memory_order_acquire) != index + 1) {
+            continue;
+        }
+
+        const char* const name = slot.name.load(std::memory_order_relaxed);
+        const std::uint64_t link = slot.link.load(std::memory_order_relaxed);
+        const std::int64_t start = slot.start.load(std::memory_order_relaxed);
+        const std::int64_t end = slot.end.load(std::memory_order_relaxed);
+        const std::uint32_t thread = slot.thread.load(std::memory_order_relaxed);
+        const detail::trace_phase phase = slot.phase.load(std::memory_order_relaxed);
+
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (slot.sequence.load(std::memory_order_relaxed) != index + 1) {
+            continue;
+        }
+
+        // Trace-event timestamps are microseconds, the fraction keeps nanosecond resolution
+        const double ts = static_cast<double>(start) / 1000.0;
+        int length = 0;
+        switch (phase) {
+        case detail::trace_phase::complete:
+            length = std::snprintf(event, sizeof(event),
+                "{\"name\":\"%s\",\"cat\":\"dplnk\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":%" PRIu32 ",\"tid\":%" PRIu32,
+                name, ts, static_cast<double>(end - start) / 1000.0, pid, thread);
+            if (length > 0 && static_cast<std::size_t>(length) < sizeof(event)) {
+                length += link != 0
+                    ? std::snprintf(event + length, sizeof(event) - static_cast<std::size_t>(length), ",\"args\":{\"link\":\"%016" PRIx64 "\"}}", link)
+                    : std::snprintf(event + length, sizeof(event) - static_cast<std::size_t>(length), "}");
+            }
+            break;
+        case detail::trace_phase::flow_begin:
+        case detail::trace_phase::flow_end:
+            // Binds to the span enclosing it on the same thread; "e" binding lets the arrow end on a span that starts here
+            length = std::snprintf(event, sizeof(event),
+                "{\"name\":\"%s\",\"cat\":\"dplnk\",\"ph\":\"%s\",\"id\":\"%016" PRIx64 "\",\"ts\":%.3f,\"pid\":%" PRIu32 ",\"tid\":%" PRIu32 "%s}",
+                name, phase == detail::trace_phase::flow_begin ? "s" : "f", link, ts, pid, thread, phase == detail::trace_phase::flow_end ? ",\"bp\":\"e\"" : "");
+            break;
+        }
+
+        if (length <= 0 || static_cast<std::size_t>(length) >= sizeof(event)) {
+            continue;
+        }
+
+        if (!first) {
+            json += ',';
+        }
+        json.append(event, static_cast<std::size_t>(length));
+        first = false;
+    }
+
+    json += "]}";
+    return json;
+#endif
+}
+
+void dplnk::clear_trace() noexcept {
+#ifdef DPLNK_ENABLE_TRACING
+    ring& ring = events();
+    for (slot& slot : ring.slots) {
+        slot.sequence.store(0, std::memory_order_relaxed);
+    }
+#endif
+}
@@ -0,0 +1,341 @@
+﻿#include "watch.h"
+
+#include "dplnk.h"
+#include "lookup.h"
+#include "trace.h"
+
+#include <atomic>
+#include <stdexcept>
+#include <system_error>
+#include <thread>
+
+#ifdef _WIN32 // Windows
+#include "subsystems/windows.h"
+
+#include <vector>
+#elif defined(__linux__) // Linux
+#include "xdg.hpp"
+
+#include <array>
+#include <unordered_map>
+
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+namespace dplnk::detail {
+    struct watch_state {
+        std::string protocol;
+        watch_options options;
+
+        std::atomic<std::uint64_t> changes{ 0 };
+        std::atomic<std::uint64_t> reassertions{ 0 };
+
+#ifdef _WIN32 // Windows
+        HANDLE stop = nullptr;
+        HANDLE changed = nullptr;
+#elif defined(__linux__) // Linux
+        int inotify = -1;
+        int stop = -1;
+        // Watched directory of every descriptor, and whether it lies inside an applications tree
+        std::unordered_map<int, std::pair<std::filesystem::path, bool>> watched;
+#endif
+
+        std::thread thread;
+    };
+} // namespace dplnk::detail
+
+namespace {
+    // Called once a burst of changes has settled
+    void changed(dplnk::detail::watch_state& state) {
+        DPLNK_TRACE_SPAN("registration changed");
+
+        state.changes.fetch_add(1, std::memory_order_relaxed);
+        dplnk::scheme_index::invalidate();
+
+        if (state.options.reassert.has_value()) {
+            // Our own rewrite shows up as the next change and finds the registration ours, so this cannot loop
+            const auto index = dplnk::scheme_index::current();
+            const dplnk::registration_info* info = index->find(state.protocol);
+            if (info == nullptr || info->path != *state.options.reassert) {
+                try {
+                    dplnk::dplnk(*state.options.reassert, { state.protocol, state.options.d });
+                    state.reassertions.fetch_add(1, std::memory_order_relaxed);
+                } catch (...) {
+                    // Retried on the next change
+                }
+            }
+        }
+
+        if (state.options.on_change) {
+            try {
+                state.options.on_change();
+            } catch (...) {
+                // Nothing sensible to report to on the watcher thread
+            }
+        }
+    }
+
+#ifdef _WIN32 // Windows
+    void watch(dplnk::detail::watch_state& state) {
+        const std::wstring protocol(state.protocol.begin(), state.protocol.end());
+
+        std::vector<WinReg::RegKey> keys;
+        const auto arm = [&] {
+            // Closing a key signals its pending notification, so the event is reset only afterwards
+            keys.clear();
+            ResetEvent(state.changed);
+
+            // Until the scheme exists, only the creation of its key (a name change among the classes) is of interest
+            WinReg::RegKey protocolkey;
+            if (protocolkey.tryOpen(HKEY_CLASSES_ROOT, protocol, KEY_NOTIFY | KEY_READ)) {
+                RegNotifyChangeKeyValue(protocolkey.get(), TRUE, REG_NOTIFY_CHANGE_NAME | REG_NOTIFY_CHANGE_LAST_SET, state.changed, TRUE);
+                keys.push_back(std::move(protocolkey));
+            } else {
+                WinReg::RegKey classes;
+                if (classes.tryOpen(HKEY_CURRENT_USER, L"Software\\Classes", KEY_NOTIFY)) {
+                    RegNotifyChangeKeyValue(classes.get(), FALSE, REG_NOTIFY_CHANGE_NAME, state.changed, TRUE);
+                    keys.push_back(std::move(classes));
+                }
+            }
+
+            // Where the shell records the user's choice of handler, which is how other apps usually take a scheme over
+            WinReg::RegKey association;
+            if (association.tryOpen(HKEY_CURRENT_USER, L"Software\\Microsoft\\Windows\\Shell\\Associations\\UrlAssociations\\" + protocol, KEY_NOTIFY)) {
+                RegNotifyChangeKeyValue(association.get(), TRUE, REG_NOTIFY_CHANGE_NAME | REG_NOTIFY_CHANGE_LAST_SET, state.changed, TRUE);
+                keys.push_back(std::move(association));
+            }
+        };
+
+        bool pending = false;
+        while (true) {
+            // Re-armed before the index is rebuilt, so a change during the rebuild is not lost
+            arm();
+            if (pending) {
+                changed(state);
+                pending = false;
+            }
+
+            const HANDLE handles[] = { state.stop, state.changed };
+            if (WaitForMultipleObjects(2, handles, FALSE, INFINITE) != WAIT_OBJECT_0 + 1) {
+                return;
+            }
+
+            if (WaitForSingleObject(state.stop, static_cast<DWORD>(state.options.settle.count())) != WAIT_TIMEOUT) {
+                return;
+            }
+            pending = true;
+        }
+    }
+#elif defined(__linux__) // Linux
+    constexpr std::uint32_t directory_events = IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_CLOSE_WRITE | IN_DELETE_SELF | IN_ONLYDIR;
+
+    void add_watch(dplnk::detail::watch_state& state, const std::filesystem::path& dir, bool tree) {
+        const int wd = inotify_add_watch(state.inotify, dir.c_str(), directory_events);
+        if (wd >= 0) {
+            state.watched.insert_or_assign(wd, std::pair{ dir, tree });
+        }
+    }
+
+    // Desktop file ids include subdirectories, so the whole tree is watched
+    void add_tree(dplnk::detail::watch_state& state, const std::filesystem::path& applications) {
+        add_watch(state, applications, true);
+
+        std::error_code error;
+        std::filesystem::recursive_directory_iterator it{ applications, std::filesystem::directory_options::skip_permission_denied, error };
+        for (const std::filesystem::recursive_directory_iterator end; !error && it != end; it.increment(error)) {
+            if (it->is_directory(error)) {
+                add_watch(state, it->path(), true);
+            }
+        }
+    }
+
+    // Directories that do not exist yet are picked up when they are created inside the nearest one that does
+    void add_dir(dplnk::detail::watch_state& state, const std::filesystem::path& dir, bool tree) {
+        std::error_code error;
+        if (std::filesystem::is_directory(dir, error)) {
+            tree ? add_tree(state, dir) : add_watch(state, dir, false);
+        } else if (std::filesystem::is_directory(dir.parent_path(), error)) {
+            add_watch(state, dir.parent_path(), false);
+        }
+    }
+
+    void add_all(dplnk::detail::watch_state& state) {
+        for (const auto& dir : dplnk::detail::xdg::data_dirs()) {
+            add_dir(state, dir / "applications", true);
+        }
+        for (const auto& dir : dplnk::detail::xdg::config_dirs()) {
+            add_dir(state, dir, false);
+        }
+    }
+
+    bool relevant(std::string_view name) {
+        // Temporary files written before a rename are not, the rename itself is
+        return name.ends_with(".desktop") || name.ends_with("mimeapps.list") || name == "mimeinfo.cache";
+    }
+
+    // Drains queued events, returns whether any of them matters to the index
+    bool read_events(dplnk::detail::watch_state& state) {
+        alignas(inotify_event) std::array<char, 16 * 1024> buffer;
+        bool matters = false;
+
+        while (true) {
+            const ssize_t size = read(state.inotify, buffer.data(), buffer.size());
+            if (size <= 0) {
+                return matters;
+            }
+
+            for (ssize_t at = 0; at < size;) {
+                const auto* const event = reinterpret_cast<const inotify_event*>(buffer.data() + at);
+                at += static_cast<ssize_t>(sizeof(inotify_event) + event->len);
+
+                if (event->mask & IN_Q_OVERFLOW) {
+                    matters = true;
+                    continue;
+                }
+
+                const auto it = state.watched.find(event->wd);
+                if (it == state.watched.end()) {
+                    continue;
+                }
+
+                if (event->mask & (IN_IGNORED | IN_DELETE_SELF)) {
+                    matters |= it->second.second;
+                    if (event->mask & IN_IGNORED) {
+                        state.watched.erase(it);
+                    }
+                    continue;
+                }
+
+                const std::string_view name = event->len > 0 ? std::string_view{ event->name } : std::string_view{};
+                if ((event->mask & IN_ISDIR) && (event->mask & (IN_CREATE | IN_MOVED_TO))) {
+                    const auto [dir, tree] = it->second;
+                    if (tree || name == "applications") {
+                        add_tree(state, dir / name);
+                        matters = true;
+                    }
+                    continue;
+                }
+
+                matters |= relevant(name) || ((event->mask & IN_ISDIR) && it->second.second);
+            }
+        }
+    }
+
+    void watch(dplnk::detail::watch_state& state) {
+        pollfd fds[] = { { state.stop, POLLIN, 0 }, { state.inotify, POLLIN, 0 } };
+
+        while (true) {
+            if (poll(fds, 2, -1) < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                return;
+            }
+            if (fds[0].revents != 0) {
+                return;
+            }
+            if (!read_events(state)) {
+                continue;
+            }
+
+            // Wait until the burst has been quiet for `settle`
+            const int settle = static_cast<int>(state.options.settle.count());
+            while (poll(fds, 2, settle) > 0) {
+                if (fds[0].revents != 0) {
+                    return;
+                }
+                read_events(state);
+            }
+
+            changed(state);
+        }
+    }
+#endif
+
+    void close_handles([[maybe_unused]] dplnk::detail::watch_state& state) noexcept {
+#ifdef _WIN32 // Windows
+        CloseHandle(state.stop);
+        CloseHandle(state.changed);
+#elif defined(__linux__) // Linux
+        close(state.inotify);
+        close(state.stop);
+#endif
+    }
+} // namespace
+
+dplnk::registration_watcher::registration_watcher(std::string protocol, dplnk::watch_options options) : state{ std::make_unique<detail::watch_state>() } {
+    if (!is_valid_scheme(protocol)) {
+        throw std::invalid_argument("Invalid protocol: '" + protocol + "' is not a valid URL scheme");
+    }
+
+    state->protocol = std::move(protocol);
+    state->options = std::move(options);
+
+#ifdef _WIN32 // Windows
+    state->stop = CreateEventW(nullptr, TRUE, FALSE, nullptr);
+    state->changed = CreateEventW(nullptr, TRUE, FALSE, nullptr);
+    if (state->stop == nullptr || state->changed == nullptr) {
+        const std::error_code error{ static_cast<int>(GetLastError()), std::system_category() };
+        if (state->stop != nullptr) {
+            CloseHandle(state->stop);
+        }
+        if (state->changed != nullptr) {
+            CloseHandle(state->changed);
+        }
+        throw std::system_error(error, "CreateEventW");
+    }
+#elif defined(__linux__) // Linux
+    state->inotify = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (state->inotify < 0) {
+        throw std::system_error(errno, std::generic_category(), "inotify_init1");
+    }
+
+    state->stop = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (state->stop < 0) {
+        const int error = errno;
+        close(state->inotify);
+        throw std::system_error(error, std::generic_category(), "eventfd");
+    }
+#else
+    throw std::runtime_error("Unsupported platform!");
+#endif
+
+#if defined(_WIN32) || defined(__linux__)
+    // The destructor does not run for a constructor that throws, so the handles are closed here
+    try {
+#ifdef __linux__ // Linux
+        add_all(*state);
+#endif
+        state->thread = std::thread{ [state = state.get()] { watch(*state); } };
+    } catch (...) {
+        close_handles(*state);
+        throw;
+    }
+#endif
+}
+
+dplnk::registration_watcher::~registration_watcher() {
+#ifdef _WIN32 // Windows
+    SetEvent(state->stop);
+#elif defined(__linux__) // Linux
+    const std::uint64_t one = 1;
+    [[maybe_unused]] const ssize_t written = write(state->stop, &one, sizeof(one));
+#endif
+
+    if (state->thread.joinable()) {
+        state->thread.join();
+    }
+
+    close_handles(*state);
+}
+
+std::uint64_t dplnk::registration_watcher::changes() const noexcept {
+    return state->changes.load(std::memory_order_relaxed);
+}
+
+std::uint64_t dplnk::registration_watcher::reassertions() const noexcept {
+    return state->reassertions.load(std::memory_order_relaxed);
+}
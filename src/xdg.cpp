@@ -0,0 +1,853 @@
+﻿#include "xdg.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstdio>
+#include <stdexcept>
+#include <system_error>
+
+// The file formats are plain text and also generated on Windows hosts, only the file access below is POSIX
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+    std::string_view trim(std::string_view text) noexcept {
+        while (!text.empty() && (text.front() == ' ' || text.front() == '\t')) {
+            text.remove_prefix(1);
+        }
+        while (!text.empty() && (text.back() == ' ' || text.back() == '\t' || text.back() == '\r')) {
+            text.remove_suffix(1);
+        }
+        return text;
+    }
+
+    std::vector<std::string> split_lines(std::string_view content) {
+        std::vector<std::string> lines;
+        while (!content.empty()) {
+            const auto newline = content.find('\n');
+            lines.emplace_back(content.substr(0, newline));
+            content.remove_prefix(newline == std::string_view::npos ? content.size() : newline + 1);
+        }
+        return lines;
+    }
+
+    std::string join_lines(const std::vector<std::string>& lines) {
+        std::string content;
+        for (const auto& line : lines) {
+            content.append(line).append("\n");
+        }
+        return content;
+    }
+
+    bool is_group(std::string_view line) noexcept {
+        line = trim(line);
+        return line.size() >= 2 && line.front() == '[' && line.back() == ']';
+    }
+
+    // Key of a `key=value` line, empty for comments, blank lines and group headers
+    std::string_view key_of(std::string_view line) noexcept {
+        const std::string_view trimmed = trim(line);
+        if (trimmed.empty() || trimmed.front() == '#' || is_group(trimmed)) {
+            return {};
+        }
+        const auto equals = trimmed.find('=');
+        return equals == std::string_view::npos ? std::string_view{} : trim(trimmed.substr(0, equals));
+    }
+
+    std::string_view value_of(std::string_view line) noexcept {
+        const auto equals = line.find('=');
+        return equals == std::string_view::npos ? std::string_view{} : trim(line.substr(equals + 1));
+    }
+
+    // Line range [first, last) of the keys in `group`, nothing if the group is missing
+    std::optional<std::pair<std::size_t, std::size_t>> locate_group(const std::vector<std::string>& lines, std::string_view group) {
+        const std::string header = "[" + std::string{ group } + "]";
+
+        std::size_t first = 0;
+        while (first < lines.size() && trim(lines[first]) != header) {
+            ++first;
+        }
+        if (first == lines.size()) {
+            return std::nullopt;
+        }
+
+        std::size_t last = ++first;
+        while (last < lines.size() && !is_group(lines[last])) {
+            ++last;
+        }
+        // Keep blank lines between groups where they were
+        while (last > first && trim(lines[last - 1]).empty()) {
+            --last;
+        }
+        return std::pair{ first, last };
+    }
+
+    // Like `locate_group`, but the group is appended if it is missing
+    std::pair<std::size_t, std::size_t> find_group(std::vector<std::string>& lines, std::string_view group) {
+        if (const auto range = locate_group(lines, group)) {
+            return *range;
+        }
+
+        if (!lines.empty() && !trim(lines.back()).empty()) {
+            lines.emplace_back();
+        }
+        lines.push_back("[" + std::string{ group } + "]");
+        return { lines.size(), lines.size() };
+    }
+
+    std::string join_list(const std::vector<std::string>& items) {
+        std::string value;
+        for (const auto& item : items) {
+            value.append(item).append(";");
+        }
+        return value;
+    }
+
+    // Rewrites the list of every handler's mime type in `group` with `edit(handler, items)` in one pass over the group,
+    // removing keys whose list ends up empty and appending new keys in the order they were first edited
+    template<typename Edit>
+    void edit_lists(std::vector<std::string>& lines, std::string_view group, const std::vector<std::pair<std::string, std::string>>& handlers, Edit&& edit) {
+        const auto [first, last] = find_group(lines, group);
+
+        std::map<std::string, std::size_t, std::less<>> existing;
+        for (std::size_t i = first; i < last; ++i) {
+            if (const auto key = key_of(lines[i]); !key.empty()) {
+                existing.try_emplace(std::string{ key }, i);
+            }
+        }
+
+        std::map<std::string, std::vector<std::string>, std::less<>> lists;
+        std::vector<std::string> appended;
+        for (const auto& handler : handlers) {
+            auto it = lists.find(handler.first);
+            if (it == lists.end()) {
+                const auto line = existing.find(handler.first);
+                if (line == existing.end()) {
+                    appended.push_back(handler.first);
+                }
+                it = lists.emplace(handler.first, line != existing.end() ? dplnk::detail::xdg::split_list(value_of(lines[line->second])) : std::vector<std::string>{}).first;
+            }
+            edit(handler, it->second);
+        }
+
+        std::vector<bool> removed(lines.size());
+        for (const auto& [key, items] : lists) {
+            if (const auto line = existing.find(key); line != existing.end()) {
+                if (items.empty()) {
+                    removed[line->second] = true;
+                } else {
+                    lines[line->second] = key + "=" + join_list(items);
+                }
+            }
+        }
+
+        std::vector<std::string> edited;
+        edited.reserve(lines.size() + appended.size());
+        for (std::size_t i = 0; i < lines.size(); ++i) {
+            if (i == last) {
+                for (const auto& key : appended) {
+                    if (const auto& items = lists.at(key); !items.empty()) {
+                        edited.push_back(key + "=" + join_list(items));
+                    }
+                }
+            }
+            if (!removed[i]) {
+                edited.push_back(std::move(lines[i]));
+            }
+        }
+        if (last == lines.size()) {
+            for (const auto& key : appended) {
+                if (const auto& items = lists.at(key); !items.empty()) {
+                    edited.push_back(key + "=" + join_list(items));
+                }
+            }
+        }
+        lines = std::move(edited);
+    }
+
+    std::vector<std::string> split_list_of(std::string_view value, char separator) {
+        std::vector<std::string> items;
+        while (!value.empty()) {
+            const auto at = value.find(separator);
+            if (at != 0) {
+                items.emplace_back(value.substr(0, at));
+            }
+            value.remove_prefix(at == std::string_view::npos ? value.size() : at + 1);
+        }
+        return items;
+    }
+} // namespace
+
+std::filesystem::path dplnk::detail::xdg::data_home(std::error_code& error) {
+    error.clear();
+    // The spec ignores relative paths
+    if (const char* data = std::getenv("XDG_DATA_HOME"); data != nullptr && data[0] == '/') {
+        return data;
+    }
+    if (const char* home = std::getenv("HOME"); home != nullptr && home[0] != '\0') {
+        return std::filesystem::path{ home } / ".local" / "share";
+    }
+    error = std::make_error_code(std::errc::no_such_file_or_directory);
+    return {};
+}
+
+std::filesystem::path dplnk::detail::xdg::data_home() {
+    std::error_code error;
+    auto home = data_home(error);
+    if (error) {
+        throw std::runtime_error("Cannot locate the user's data directory!");
+    }
+    return home;
+}
+
+std::filesystem::path dplnk::detail::xdg::config_home(std::error_code& error) {
+    error.clear();
+    if (const char* config = std::getenv("XDG_CONFIG_HOME"); config != nullptr && config[0] == '/') {
+        return config;
+    }
+    if (const char* home = std::getenv("HOME"); home != nullptr && home[0] != '\0') {
+        return std::filesystem::path{ home } / ".config";
+    }
+    error = std::make_error_code(std::errc::no_such_file_or_directory);
+    return {};
+}
+
+std::filesystem::path dplnk::detail::xdg::config_home() {
+    std::error_code error;
+    auto home = config_home(error);
+    if (error) {
+        throw std::runtime_error("Cannot locate the user's config directory!");
+    }
+    return home;
+}
+
+std::vector<std::filesystem::path> dplnk::detail::xdg::data_dirs() {
+    std::vector<std::filesystem::path> dirs{ data_home() };
+
+    const char* system = std::getenv("XDG_DATA_DIRS");
+    for (const auto& dir : split_list_of(system != nullptr && system[0] != '\0' ? system : "/usr/local/share/:/usr/share/", ':')) {
+        if (dir.starts_with('/')) {
+            dirs.emplace_back(dir);
+        }
+    }
+    return dirs;
+}
+
+std::vector<std::filesystem::path> dplnk::detail::xdg::config_dirs() {
+    std::vector<std::filesystem::path> dirs{ config_home() };
+
+    const char* system = std::getenv("XDG_CONFIG_DIRS");
+    for (const auto& dir : split_list_of(system != nullptr && system[0] != '\0' ? system : "/etc/xdg", ':')) {
+        if (dir.starts_with('/')) {
+            dirs.emplace_back(dir);
+        }
+    }
+    return dirs;
+}
+
+std::vector<std::string> dplnk::detail::xdg::current_desktops() {
+    const char* current = std::getenv("XDG_CURRENT_DESKTOP");
+    auto desktops = split_list_of(current != nullptr ? current : "", ':');
+    for (auto& desktop : desktops) {
+        std::transform(desktop.begin(), desktop.end(), desktop.begin(), [](char c) { return c >= 'A' && c <= 'Z' ? static_cast<char>(c - 'A' + 'a') : c; });
+    }
+    return desktops;
+}
+
+std::vector<std::filesystem::path> dplnk::detail::xdg::mimeapps_lists() {
+    // mime-apps spec: config dirs before data dirs, and in each directory the desktop-specific lists before the generic one
+    const auto desktops = current_desktops();
+    std::vector<std::filesystem::path> lists;
+
+    const auto add = [&](const std::filesystem::path& dir) {
+        for (const auto& desktop : desktops) {
+            lists.push_back(dir / (desktop + "-mimeapps.list"));
+        }
+        lists.push_back(dir / "mimeapps.list");
+    };
+
+    for (const auto& dir : config_dirs()) {
+        add(dir);
+    }
+    for (const auto& dir : data_dirs()) {
+        add(dir / "applications");
+    }
+    return lists;
+}
+
+std::string dplnk::detail::xdg::scheme_mime(std::string_view protocol) {
+    return "x-scheme-handler/" + std::string{ protocol };
+}
+
+std::string dplnk::detail::xdg::desktop_id(std::string_view protocol) {
+    return "dplnk-" + std::string{ protocol } + ".desktop";
+}
+
+std::string dplnk::detail::xdg::escape_value(std::string_view value) {
+    std::string escaped;
+    escaped.reserve(value.size());
+
+    for (const char c : value) {
+        switch (c) {
+        case '\\': escaped += "\\\\"; break;
+        case '\n': escaped += "\\n"; break;
+        case '\t': escaped += "\\t"; break;
+        case '\r': escaped += "\\r"; break;
+        default: escaped += c; break;
+        }
+    }
+
+    // Leading spaces would be trimmed by readers
+    if (!escaped.empty() && escaped.front() == ' ') {
+        escaped.replace(0, 1, "\\s");
+    }
+    return escaped;
+}
+
+std::string dplnk::detail::xdg::exec_argument(std::string_view argument) {
+    std::string quoted = "\"";
+    for (const char c : argument) {
+        if (c == '"' || c == '`' || c == '$' || c == '\\') {
+            quoted += '\\';
+        }
+        // A literal percent sign would otherwise start a field code
+        if (c == '%') {
+            quoted += '%';
+        }
+        quoted += c;
+    }
+    quoted += '"';
+    return escape_value(quoted);
+}
+
+std::string dplnk::detail::xdg::desktop_file(std::string_view protocol, std::string_view description, const std::string& path, const std::optional<std::map<std::string, std::string>>& d) {
+    std::string content = "[Desktop Entry]\n"
+        "Type=Application\n"
+        "Name=" + escape_value(description) + "\n"
+        "Exec=" + exec_argument(path) + " %u\n"
+        "Terminal=false\n"
+        "NoDisplay=true\n"
+        "MimeType=" + scheme_mime(protocol) + ";\n";
+
+    if (d.has_value() && !d->empty()) {
+        content += "\n[X-Dplnk Values]\n";
+        for (const auto& [key, value] : *d) {
+            content += escape_value(key) + "=" + escape_value(value) + "\n";
+        }
+    }
+
+    return content;
+}
+
+std::map<std::string, std::string, std::less<>> dplnk::detail::xdg::read_group(std::string_view content, std::string_view group) {
+    std::map<std::string, std::string, std::less<>> keys;
+    bool inside = false;
+
+    while (!content.empty()) {
+        const auto newline = content.find('\n');
+        const std::string_view line = content.substr(0, newline);
+        content.remove_prefix(newline == std::string_view::npos ? content.size() : newline + 1);
+
+        if (is_group(line)) {
+            const std::string_view name = trim(line);
+            if (inside) {
+                break;
+            }
+            inside = name.substr(1, name.size() - 2) == group;
+            continue;
+        }
+
+        if (inside) {
+            if (const std::string_view key = key_of(line); !key.empty()) {
+                // The first occurrence wins, later duplicates are invalid
+                keys.try_emplace(std::string{ key }, value_of(line));
+            }
+        }
+    }
+
+    return keys;
+}
+
+std::vector<std::string> dplnk::detail::xdg::split_list(std::string_view value) {
+    std::vector<std::string> items;
+    while (!value.empty()) {
+        const auto semicolon = value.find(';');
+        const std::string_view item = trim(value.substr(0, semicolon));
+        if (!item.empty()) {
+            items.emplace_back(item);
+        }
+        value.remove_prefix(semicolon == std::string_view::npos ? value.size() : semicolon + 1);
+    }
+    return items;
+}
+
+std::string dplnk::detail::xdg::set_default_handlers(std::string_view content, const std::vector<std::pair<std::string, std::string>>& handlers) {
+    auto lines = split_lines(content);
+
+    const auto prefer = [](const auto& handler, std::vector<std::string>& items) {
+        std::erase(items, handler.second);
+        items.insert(items.begin(), handler.second);
+    };
+
+    edit_lists(lines, "Default Applications", handlers, prefer);
+    edit_lists(lines, "Added Associations", handlers, prefer);
+    // Only a group that is already there can list one of the handlers
+    if (locate_group(lines, "Removed Associations")) {
+        edit_lists(lines, "Removed Associations", handlers, [](const auto& handler, std::vector<std::string>& items) {
+            std::erase(items, handler.second);
+        });
+    }
+
+    return join_lines(lines);
+}
+
+std::string dplnk::detail::xdg::remove_handlers(std::string_view content, const std::set<std::string, std::less<>>& ids) {
+    std::vector<std::string> edited;
+
+    // Where the association group being edited starts in `edited` (npos outside one), it is dropped if removing ids left it empty
+    constexpr std::size_t npos = static_cast<std::size_t>(-1);
+    std::size_t header = npos;
+    bool emptied = false;
+    bool kept = false;
+    const auto close_group = [&] {
+        if (header != npos && emptied && !kept) {
+            edited.resize(header);
+        }
+        header = npos;
+        emptied = false;
+        kept = false;
+    };
+
+    for (auto& line : split_lines(content)) {
+        if (is_group(line)) {
+            close_group();
+            const std::string_view name = trim(line);
+            if (name == "[Default Applications]" || name == "[Added Associations]" || name == "[MIME Cache]") {
+                header = edited.size();
+            }
+        } else if (header != npos && !trim(line).empty()) {
+            if (const std::string_view key = key_of(line); !key.empty()) {
+                auto items = split_list(value_of(line));
+                if (std::erase_if(items, [&](const std::string& id) { return ids.contains(id); }) != 0) {
+                    // Lines whose list ends up empty are dropped
+                    if (items.empty()) {
+                        emptied = true;
+                        continue;
+                    }
+                    line = std::string{ key } + "=" + join_list(items);
+                }
+            }
+            kept = true;
+        }
+
+        edited.push_back(std::move(line));
+    }
+    close_group();
+
+    return join_lines(edited);
+}
+
+std::string dplnk::detail::xdg::unescape_value(std::string_view value) {
+    std::string unescaped;
+    unescaped.reserve(value.size());
+
+    for (std::size_t i = 0; i < value.size(); ++i) {
+        if (value[i] != '\\' || i + 1 == value.size()) {
+            unescaped += value[i];
+            continue;
+        }
+
+        switch (value[++i]) {
+        case 's': unescaped += ' '; break;
+        case 'n': unescaped += '\n'; break;
+        case 't': unescaped += '\t'; break;
+        case 'r': unescaped += '\r'; break;
+        case '\\': unescaped += '\\'; break;
+        default:
+            // Unknown escapes (such as `\;` inside lists) are kept for the next stage to interpret
+            unescaped += '\\';
+            unescaped += value[i];
+            break;
+        }
+    }
+    return unescaped;
+}
+
+std::vector<std::string> dplnk::detail::xdg::split_exec(std::string_view exec) {
+    std::vector<std::string> arguments;
+    std::string current;
+    bool quoted = false;
+    bool pending = false;
+
+    for (std::size_t i = 0; i < exec.size(); ++i) {
+        const char c = exec[i];
+        if (quoted) {
+            if (c == '"') {
+                quoted = false;
+            } else if (c == '\\' && i + 1 < exec.size()) {
+                current += exec[++i];
+            } else {
+                current += c;
+            }
+        } else if (c == '"') {
+            quoted = true;
+            pending = true;
+        } else if (c == ' ' || c == '\t') {
+            if (pending) {
+                arguments.push_back(std::move(current));
+                current.clear();
+                pending = false;
+            }
+        } else {
+            current += c;
+            pending = true;
+        }
+    }
+
+    if (pending) {
+        arguments.push_back(std::move(current));
+    }
+    return arguments;
+}
+
+std::vector<std::string> dplnk::detail::xdg::expand_field_codes(const std::vector<std::string>& arguments, std::string_view url) {
+    constexpr auto takes_url = [](char code) { return code == 'u' || code == 'U' || code == 'f' || code == 'F'; };
+
+    std::vector<std::string> expanded;
+    expanded.reserve(arguments.size());
+
+    for (const auto& argument : arguments) {
+        // A standalone code with nothing to expand to (%i, %c, %k and the deprecated ones) removes the argument
+        if (argument.size() == 2 && argument[0] == '%' && argument[1] != '%') {
+            if (takes_url(argument[1])) {
+                expanded.emplace_back(url);
+            }
+            continue;
+        }
+
+        std::string text;
+        text.reserve(argument.size());
+        for (std::size_t i = 0; i < argument.size(); ++i) {
+            if (argument[i] != '%' || i + 1 == argument.size()) {
+                text += argument[i];
+                continue;
+            }
+
+            const char code = argument[++i];
+            if (code == '%') {
+                text += '%';
+            } else if (takes_url(code)) {
+                text += url;
+            }
+        }
+        expanded.push_back(std::move(text));
+    }
+
+    return expanded;
+}
+
+std::string dplnk::detail::xdg::exec_program(std::string_view exec) {
+    auto arguments = split_exec(exec);
+    if (arguments.empty()) {
+        return {};
+    }
+
+    arguments.resize(1);
+    auto expanded = expand_field_codes(arguments, {});
+    return expanded.empty() ? std::string{} : std::move(expanded.front());
+}
+
+dplnk::detail::xdg::desktop_entry dplnk::detail::xdg::parse_desktop_entry(std::string_view content) {
+    desktop_entry entry;
+
+    const auto main = read_group(content, "Desktop Entry");
+    if (const auto exec = main.find("Exec"); exec != main.end()) {
+        entry.exec = unescape_value(exec->second);
+    }
+    if (const auto types = main.find("MimeType"); types != main.end()) {
+        entry.mime_types = split_list(types->second);
+    }
+    if (const auto hidden = main.find("Hidden"); hidden != main.end()) {
+        entry.hidden = hidden->second == "true";
+    }
+
+    for (const auto& [key, value] : read_group(content, "X-Dplnk Values")) {
+        entry.values.emplace(unescape_value(key), unescape_value(value));
+    }
+    return entry;
+}
+
+#ifndef _WIN32
+namespace {
+    // Desktop file ids name subdirectories with `-`, so `foo-bar.desktop` may also be `foo/bar.desktop`
+    std::optional<std::filesystem::path> locate(const std::filesystem::path& directory, std::string_view id) {
+        std::error_code error;
+        if (std::filesystem::is_regular_file(directory / id, error)) {
+            return directory / id;
+        }
+
+        for (auto dash = id.find('-'); dash != std::string_view::npos; dash = id.find('-', dash + 1)) {
+            const auto nested = directory / id.substr(0, dash);
+            if (std::filesystem::is_directory(nested, error)) {
+                if (auto found = locate(nested, id.substr(dash + 1))) {
+                    return found;
+                }
+            }
+        }
+
+        return std::nullopt;
+    }
+} // namespace
+
+std::string dplnk::detail::xdg::patch_mimeinfo_cache(std::string_view content, const std::vector<std::pair<std::string, std::string>>& handlers, const std::filesystem::path& applications) {
+    auto lines = split_lines(content);
+
+    // Only the files the entries name are re-read, where the rebuild would read every file in the directory
+    std::map<std::string, bool> declares;
+    const auto declared = [&](const std::string& id, std::string_view mime) {
+        const auto file = locate(applications, id);
+        if (!file) {
+            return false;
+        }
+
+        // Unreadable files are left out, like update-desktop-database does
+        std::error_code error;
+        const auto entry = read_group(read_file(*file, error), "Desktop Entry");
+        const auto types = entry.find("MimeType");
+        if (types == entry.end()) {
+            return false;
+        }
+        const auto list = split_list(types->second);
+        return std::find(list.begin(), list.end(), mime) != list.end();
+    };
+
+    // The caller is writing each handler's id for its mime type, possibly not on disk yet
+    std::set<std::pair<std::string_view, std::string_view>> added;
+    for (const auto& [mime, id] : handlers) {
+        added.emplace(mime, id);
+    }
+
+    // Every other id already listed is checked again, the way update-desktop-database would
+    edit_lists(lines, "MIME Cache", handlers, [&](const auto& handler, std::vector<std::string>& items) {
+        if (std::find(items.begin(), items.end(), handler.second) == items.end()) {
+            items.push_back(handler.second);
+        }
+        std::erase_if(items, [&](const std::string& id) {
+            if (added.contains({ handler.first, id })) {
+                return false;
+            }
+            const auto [it, inserted] = declares.try_emplace(handler.first + "\n" + id);
+            if (inserted) {
+                it->second = declared(id, handler.first);
+            }
+            return !it->second;
+        });
+    });
+
+    // update-desktop-database writes the types sorted, new ones were appended at the end of the group
+    const auto [first, last] = find_group(lines, "MIME Cache");
+    std::stable_sort(lines.begin() + static_cast<std::ptrdiff_t>(first), lines.begin() + static_cast<std::ptrdiff_t>(last), [](const std::string& a, const std::string& b) {
+        return key_of(a) < key_of(b);
+    });
+
+    return join_lines(lines);
+}
+
+dplnk::detail::xdg::mapped_file::mapped_file(const std::filesystem::path& path) noexcept {
+    const int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return;
+    }
+
+    struct stat info {};
+    if (fstat(fd, &info) == 0 && info.st_size > 0) {
+        void* const view = mmap(nullptr, static_cast<std::size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+        if (view != MAP_FAILED) {
+            data = static_cast<const char*>(view);
+            size = static_cast<std::size_t>(info.st_size);
+        }
+    }
+    close(fd);
+}
+
+dplnk::detail::xdg::mapped_file::~mapped_file() {
+    if (data != nullptr) {
+        munmap(const_cast<char*>(data), size);
+    }
+}
+
+void dplnk::detail::xdg::for_each_desktop_file(const std::function<void(const std::string& id, const std::filesystem::path& file)>& visit) {
+    std::set<std::string, std::less<>> seen;
+
+    for (const auto& dir : data_dirs()) {
+        const auto applications = dir / "applications";
+
+        std::error_code error;
+        std::filesystem::recursive_directory_iterator it{ applications, std::filesystem::directory_options::skip_permission_denied, error };
+        for (const std::filesystem::recursive_directory_iterator end; !error && it != end; it.increment(error)) {
+            if (it->path().extension() != ".desktop" || !it->is_regular_file(error)) {
+                continue;
+            }
+
+            std::string id = it->path().lexically_relative(applications).string();
+            std::replace(id.begin(), id.end(), '/', '-');
+            if (seen.insert(id).second) {
+                visit(id, it->path());
+            }
+        }
+    }
+}
+
+std::string dplnk::detail::xdg::read_file(const std::filesystem::path& path, std::error_code& error) {
+    error.clear();
+
+    const int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        if (errno != ENOENT) {
+            error.assign(errno, std::generic_category());
+        }
+        return {};
+    }
+
+    std::string content;
+    char buffer[16 * 1024];
+    for (ssize_t count; (count = ::read(fd, buffer, sizeof(buffer))) != 0;) {
+        if (count < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            error.assign(errno, std::generic_category());
+            close(fd);
+            return {};
+        }
+        content.append(buffer, static_cast<std::size_t>(count));
+    }
+
+    close(fd);
+    return content;
+}
+
+std::string dplnk::detail::xdg::read_file(const std::filesystem::path& path) {
+    std::error_code error;
+    std::string content = read_file(path, error);
+    if (error) {
+        throw std::system_error(error, "Cannot read '" + path.string() + "'");
+    }
+    return content;
+}
+
+std::filesystem::path dplnk::detail::xdg::write_temporary(const std::filesystem::path& path, std::string_view content, bool sync, std::error_code& error) {
+    error.clear();
+    std::string temporary = (path.parent_path() / ("." + path.filename().string() + ".XXXXXX")).string();
+
+    const int fd = mkostemp(temporary.data(), O_CLOEXEC);
+    if (fd < 0) {
+        error.assign(errno, std::generic_category());
+        return {};
+    }
+
+    const auto fail = [&] {
+        error.assign(errno, std::generic_category());
+        close(fd);
+        unlink(temporary.c_str());
+        return std::filesystem::path{};
+    };
+
+    for (std::size_t written = 0; written < content.size();) {
+        const ssize_t count = ::write(fd, content.data() + written, content.size() - written);
+        if (count < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return fail();
+        }
+        written += static_cast<std::size_t>(count);
+    }
+
+    // mkostemp creates 0600, these files are meant to be read by the desktop
+    if (fchmod(fd, 0644) != 0 || (sync && fsync(fd) != 0)) {
+        return fail();
+    }
+#ifdef __linux__
+    // The caller syncs the file later, starting writeback now lets the syncs of many files overlap
+    if (!sync) {
+        sync_file_range(fd, 0, 0, SYNC_FILE_RANGE_WRITE);
+    }
+#endif
+    close(fd);
+
+    return temporary;
+}
+
+std::filesystem::path dplnk::detail::xdg::write_temporary(const std::filesystem::path& path, std::string_view content, bool sync) {
+    std::error_code error;
+    auto temporary = write_temporary(path, content, sync, error);
+    if (error) {
+        throw std::system_error(error, "Cannot write next to '" + path.string() + "'");
+    }
+    return temporary;
+}
+
+void dplnk::detail::xdg::write_file(const std::filesystem::path& path, std::string_view content, bool sync) {
+    const auto temporary = write_temporary(path, content, sync);
+
+    if (rename(temporary.c_str(), path.c_str()) != 0) {
+        const int error = errno;
+        unlink(temporary.c_str());
+        throw std::system_error(error, std::generic_category(), "Cannot replace '" + path.string() + "'");
+    }
+}
+
+namespace {
+    // Opens `path` and runs `sync` on it
+    template<typename Sync>
+    void sync_with(const std::filesystem::path& path, int flags, std::error_code& error, Sync&& sync) noexcept {
+        error.clear();
+
+        const int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC | flags);
+        if (fd < 0) {
+            error.assign(errno, std::generic_category());
+            return;
+        }
+
+        if (sync(fd) != 0) {
+            error.assign(errno, std::generic_category());
+        }
+        close(fd);
+    }
+} // namespace
+
+void dplnk::detail::xdg::sync_file(const std::filesystem::path& path, std::error_code& error) noexcept {
+#ifdef __linux__
+    sync_with(path, 0, error, [](int fd) { return fdatasync(fd); });
+#else
+    sync_with(path, 0, error, [](int fd) { return fsync(fd); });
+#endif
+}
+
+void dplnk::detail::xdg::sync_file(const std::filesystem::path& path) {
+    std::error_code error;
+    sync_file(path, error);
+    if (error) {
+        throw std::system_error(error, "Cannot sync '" + path.string() + "'");
+    }
+}
+
+void dplnk::detail::xdg::sync_directory(const std::filesystem::path& directory, std::error_code& error) noexcept {
+    sync_with(directory, O_DIRECTORY, error, [](int fd) { return fsync(fd); });
+}
+
+void dplnk::detail::xdg::sync_directory(const std::filesystem::path& directory) {
+    std::error_code error;
+    sync_directory(directory, error);
+    if (error) {
+        throw std::system_error(error, "Cannot sync '" + directory.string() + "'");
+    }
+}
+
+#endif
@@ -0,0 +1,110 @@
+#pragma once
+
+#include <filesystem>
+#include <functional>
+#include <map>
+#include <optional>
+#include <set>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+// Freedesktop.org (XDG) helpers behind the Linux registration path
+namespace dplnk::detail::xdg {
+    [[nodiscard]] std::filesystem::path data_home();
+    [[nodiscard]] std::filesystem::path config_home();
+    // Without HOME or an absolute XDG variable there is no such directory, `error` says so instead of a throw
+    [[nodiscard]] std::filesystem::path data_home(std::error_code& error);
+    [[nodiscard]] std::filesystem::path config_home(std::error_code& error);
+
+    // Highest precedence first, the user's own directory leading
+    [[nodiscard]] std::vector<std::filesystem::path> data_dirs();
+    [[nodiscard]] std::vector<std::filesystem::path> config_dirs();
+    // `XDG_CURRENT_DESKTOP`, lowercased
+    [[nodiscard]] std::vector<std::string> current_desktops();
+    // Every mimeapps.list that may apply, highest precedence first
+    [[nodiscard]] std::vector<std::filesystem::path> mimeapps_lists();
+
+    [[nodiscard]] std::string scheme_mime(std::string_view protocol);
+    [[nodiscard]] std::string desktop_id(std::string_view protocol);
+
+    // `argument` quoted for an `Exec=` key: the Exec quoting rules first, then the string escapes of every value
+    [[nodiscard]] std::string exec_argument(std::string_view argument);
+    [[nodiscard]] std::string escape_value(std::string_view value);
+
+    // The handler entry for `protocol`, the `d` values go into an `[X-Dplnk Values]` group
+    [[nodiscard]] std::string desktop_file(std::string_view protocol, std::string_view description, const std::string& path, const std::optional<std::map<std::string, std::string>>& d);
+
+    // Keys of one group of a desktop or list file
+    [[nodiscard]] std::map<std::string, std::string, std::less<>> read_group(std::string_view content, std::string_view group);
+    // Splits a `;` separated list value
+    [[nodiscard]] std::vector<std::string> split_list(std::string_view value);
+
+    // Makes each id the default handler of its mime type in mimeapps.list content, keeping everything else as it is
+    [[nodiscard]] std::string set_default_handlers(std::string_view content, const std::vector<std::pair<std::string, std::string>>& handlers);
+
+    // Replaces the line of each mime type in a mimeinfo.cache with what update-desktop-database would write once
+    // its id is added, without re-reading every desktop file in `applications`
+    [[nodiscard]] std::string patch_mimeinfo_cache(std::string_view content, const std::vector<std::pair<std::string, std::string>>& handlers, const std::filesystem::path& applications);
+
+    // Drops `ids` from every association list of mimeapps.list or mimeinfo.cache content in one pass, keeping removals as they are
+    [[nodiscard]] std::string remove_handlers(std::string_view content, const std::set<std::string, std::less<>>& ids);
+
+    [[nodiscard]] std::string unescape_value(std::string_view value);
+    // Arguments of an unescaped `Exec` value, field codes are left in place
+    [[nodiscard]] std::vector<std::string> split_exec(std::string_view exec);
+    // Split `Exec` arguments with the field codes filled in for opening `url`. %u, %U, %f and %F become the url,
+    // %% a percent sign, and codes this library keeps nothing for are dropped.
+    [[nodiscard]] std::vector<std::string> expand_field_codes(const std::vector<std::string>& arguments, std::string_view url);
+    // The program an unescaped `Exec` value starts, with `%%` back to the `%` that `exec_argument` doubled.
+    // Empty if the value has no arguments.
+    [[nodiscard]] std::string exec_program(std::string_view exec);
+
+    struct desktop_entry {
+        std::string exec;
+        std::vector<std::string> mime_types;
+        // Hidden entries count as deleted, and hide the same id in lower-precedence directories
+        bool hidden = false;
+        std::map<std::string, std::string> values;
+    };
+
+    [[nodiscard]] desktop_entry parse_desktop_entry(std::string_view content);
+
+    // Read-only mapping of a whole file, empty if it does not exist or cannot be read
+    class mapped_file {
+    public:
+        explicit mapped_file(const std::filesystem::path& path) noexcept;
+        ~mapped_file();
+
+        mapped_file(const mapped_file&) = delete;
+        mapped_file& operator=(const mapped_file&) = delete;
+
+        [[nodiscard]] std::string_view view() const noexcept { return { data, size }; }
+
+    private:
+        const char* data = nullptr;
+        std::size_t size = 0;
+    };
+
+    // Every visible desktop file with its id (the path below `applications`, with `/` turned into `-`), once per id
+    void for_each_desktop_file(const std::function<void(const std::string& id, const std::filesystem::path& file)>& visit);
+
+    // Empty if the file does not exist
+    [[nodiscard]] std::string read_file(const std::filesystem::path& path);
+    [[nodiscard]] std::string read_file(const std::filesystem::path& path, std::error_code& error);
+
+    // Writes a sibling temporary file and renames it over `path`, so readers see either version but never a mix
+    void write_file(const std::filesystem::path& path, std::string_view content, bool sync = true);
+    // The sibling temporary file alone, for callers that rename many files after one sync
+    [[nodiscard]] std::filesystem::path write_temporary(const std::filesystem::path& path, std::string_view content, bool sync = false);
+    [[nodiscard]] std::filesystem::path write_temporary(const std::filesystem::path& path, std::string_view content, bool sync, std::error_code& error);
+
+    // Flushes the data of `path` alone (`fdatasync`), not the rest of its filesystem
+    void sync_file(const std::filesystem::path& path);
+    void sync_file(const std::filesystem::path& path, std::error_code& error) noexcept;
+    // Makes renames inside `directory` durable
+    void sync_directory(const std::filesystem::path& directory);
+    void sync_directory(const std::filesystem::path& directory, std::error_code& error) noexcept;
+} // namespace dplnk::detail::xdg
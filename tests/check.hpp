@@ -0,0 +1,16 @@
+#pragma once
+
+#include <cstdio>
+#include <source_location>
+
+// Just enough for ctest: every failed check prints where it was, `main` returns the number of failures
+namespace dplnk::test {
+    inline int failures = 0;
+
+    inline void check(bool condition, const std::source_location location = std::source_location::current()) {
+        if (!condition) {
+            ++failures;
+            std::fprintf(stderr, "%s:%u: check failed in %s\n", location.file_name(), static_cast<unsigned>(location.line()), location.function_name());
+        }
+    }
+} // namespace dplnk::test
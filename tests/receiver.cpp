@@ -0,0 +1,93 @@
+﻿#include "check.hpp"
+
+#include <dplnk/receiver.h>
+
+#include <chrono>
+#include <string>
+
+using dplnk::test::check;
+using namespace std::chrono_literals;
+
+namespace {
+    const dplnk::receiver::clock::time_point start = dplnk::receiver::clock::time_point{} + 1h;
+
+    void duplicates_are_ignored_within_the_window() {
+        dplnk::receiver receiver;
+        check(receiver.push("game://lobby?id=1", start) == dplnk::push_result::queued);
+        check(receiver.push("game://lobby?id=1", start + 10ms) == dplnk::push_result::duplicate);
+        check(receiver.push("game://lobby?id=2", start + 20ms) == dplnk::push_result::queued);
+        check(receiver.push("game://lobby?id=1", start + 2s) == dplnk::push_result::queued);
+        check(receiver.size() == 3);
+    }
+
+    void a_rate_limited_link_can_be_retried() {
+        dplnk::receiver receiver{ { .route_rate = 1.0, .route_burst = 1.0 } };
+        check(receiver.push("game://join?id=1", start) == dplnk::push_result::queued);
+        check(receiver.push("game://join?id=2", start) == dplnk::push_result::rate_limited);
+        // Not remembered while rejected, so the retry is not a duplicate
+        check(receiver.push("game://join?id=2", start + 1s) == dplnk::push_result::queued);
+    }
+
+    void a_dropped_link_can_be_retried() {
+        dplnk::receiver receiver{ { .capacity = 1, .overflow = dplnk::overflow_policy::drop_newest } };
+        check(receiver.push("game://a", start) == dplnk::push_result::queued);
+        check(receiver.push("game://b", start) == dplnk::push_result::dropped);
+
+        std::string link;
+        check(receiver.pop(link) && link == "game://a");
+        check(receiver.push("game://b", start + 1ms) == dplnk::push_result::queued);
+    }
+
+    void routes_have_their_own_burst() {
+        dplnk::receiver receiver{ { .dedupe_window = 0ms, .route_rate = 1.0, .route_burst = 2.0 } };
+        check(receiver.push("game://a", start) == dplnk::push_result::queued);
+        check(receiver.push("game://a", start) == dplnk::push_result::queued);
+        check(receiver.push("game://a", start) == dplnk::push_result::rate_limited);
+        check(receiver.push("game://b", start) == dplnk::push_result::queued);
+    }
+
+    void cycling_routes_is_still_limited() {
+        // Far more routes than slots: each one that comes back has lost its bucket and would start with a full burst
+        dplnk::receiver receiver{ { .capacity = 4096, .route_slots = 4, .total_rate = 16.0, .total_burst = 32.0 } };
+
+        std::size_t queued = 0;
+        for (int i = 0; i < 1000; ++i) {
+            const std::string link = "game://route" + std::to_string(i % 100) + "?n=" + std::to_string(i);
+            queued += receiver.push(link, start) == dplnk::push_result::queued;
+        }
+        check(queued == 32);
+
+        // The total bucket refills at its own rate
+        check(receiver.push("game://later", start + 1s) == dplnk::push_result::queued);
+        check(receiver.stats().rate_limited == 1000 - 32);
+    }
+
+    void overflow_policies() {
+        dplnk::receiver oldest{ { .capacity = 2, .overflow = dplnk::overflow_policy::drop_oldest } };
+        oldest.push("game://a", start);
+        oldest.push("game://b", start);
+        check(oldest.push("game://c", start) == dplnk::push_result::queued);
+        check(oldest.stats().evicted == 1);
+
+        std::string link;
+        check(oldest.pop(link) && link == "game://b");
+
+        dplnk::receiver coalesce{ { .capacity = 2, .overflow = dplnk::overflow_policy::coalesce } };
+        coalesce.push("game://a?v=1", start);
+        coalesce.push("game://b?v=1", start);
+        check(coalesce.push("game://b?v=2", start) == dplnk::push_result::coalesced);
+        check(coalesce.pop(link) && link == "game://a?v=1");
+        check(coalesce.pop(link) && link == "game://b?v=2");
+        check(!coalesce.pop(link));
+    }
+} // namespace
+
+int main() {
+    duplicates_are_ignored_within_the_window();
+    a_rate_limited_link_can_be_retried();
+    a_dropped_link_can_be_retried();
+    routes_have_their_own_burst();
+    cycling_routes_is_still_limited();
+    overflow_policies();
+    return dplnk::test::failures;
+}
@@ -0,0 +1,50 @@
+﻿#include "check.hpp"
+
+#include <dplnk/dplnk.h>
+#include <dplnk/lookup.h>
+
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <string>
+
+using dplnk::test::check;
+
+namespace {
+    // Registrations go to a fresh XDG home instead of the user's
+    std::filesystem::path scratch_home() {
+        const auto home = std::filesystem::temp_directory_path() / ("dplnk-test-" + std::to_string(std::chrono::steady_clock::now().time_since_epoch().count()) + "-home");
+        std::filesystem::create_directories(home);
+        setenv("XDG_DATA_HOME", (home / "data").c_str(), 1);
+        setenv("XDG_CONFIG_HOME", (home / "config").c_str(), 1);
+        setenv("XDG_DATA_DIRS", (home / "system").c_str(), 1);
+        setenv("XDG_CONFIG_DIRS", (home / "system").c_str(), 1);
+        return home;
+    }
+
+    void a_path_with_a_percent_sign_reads_back_unchanged() {
+        const std::string path = "/opt/100%game/run";
+        dplnk::dplnk(path, { "percent", std::nullopt });
+
+        const auto index = dplnk::scheme_index::build();
+        const dplnk::registration_info* const info = index.find("percent");
+        check(info != nullptr);
+        check(info != nullptr && info->path == path);
+    }
+
+    void unregister_all_for_finds_a_path_with_a_percent_sign() {
+        const std::string path = "/opt/50%off/run";
+        dplnk::dplnk(path, { "discount", std::nullopt });
+
+        check(dplnk::unregister_all_for(path) == 1);
+        check(dplnk::scheme_index::build().find("discount") == nullptr);
+    }
+} // namespace
+
+int main() {
+    const auto home = scratch_home();
+    a_path_with_a_percent_sign_reads_back_unchanged();
+    unregister_all_for_finds_a_path_with_a_percent_sign();
+    std::filesystem::remove_all(home);
+    return dplnk::test::failures;
+}
@@ -0,0 +1,79 @@
+﻿#include "check.hpp"
+
+#include <dplnk/signature.h>
+
+#include <array>
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+using dplnk::test::check;
+
+namespace {
+    std::span<const std::byte> bytes(std::string_view text) {
+        return std::as_bytes(std::span{ text.data(), text.size() });
+    }
+
+    dplnk::link_verifier verifier() {
+        dplnk::link_verifier verifier;
+        verifier.add_key("2024", bytes("a secret that is shared with the server"));
+        verifier.add_key("", bytes("the default key"));
+        return verifier;
+    }
+
+    void reference_hmac_matches_rfc_4231() {
+        // Test case 2
+        const auto digest = dplnk::detail::hmac_sha256(bytes("Jefe"), "what do ya want for nothing?");
+        constexpr unsigned char expected[] = {
+            0x5b, 0xdc, 0xc1, 0x46, 0xbf, 0x60, 0x75, 0x4e, 0x6a, 0x04, 0x24, 0x26, 0x08, 0x95, 0x75, 0xc7,
+            0x5a, 0x00, 0x3f, 0x08, 0x9d, 0x27, 0x39, 0x83, 0x9d, 0xec, 0x58, 0xb9, 0x64, 0xec, 0x38, 0x43 };
+
+        bool same = true;
+        for (std::size_t i = 0; i < digest.size(); ++i) {
+            same = same && digest[i] == std::byte{ expected[i] };
+        }
+        check(same);
+    }
+
+    void signed_links_verify() {
+        const auto verifier = ::verifier();
+        const auto link = verifier.sign("mygame://lobby/join?id=1", "2024");
+        check(link.has_value() && link->starts_with("mygame://lobby/join?id=1&kid=2024&sig="));
+        check(verifier.verify(*link) == dplnk::verify_result::valid);
+        check(verifier.verify("MYGAME" + link->substr(6)) == dplnk::verify_result::valid);
+
+        const auto plain = verifier.sign("mygame://lobby", "");
+        check(plain.has_value() && verifier.verify(*plain) == dplnk::verify_result::valid);
+    }
+
+    void fragments_stay_after_the_signature_and_are_signed() {
+        const auto verifier = ::verifier();
+        const auto link = verifier.sign("mygame://lobby?id=1#chat", "2024");
+        check(link.has_value() && link->ends_with("#chat") && link->find("&sig=") < link->find('#'));
+        check(verifier.verify(*link) == dplnk::verify_result::valid);
+
+        std::string tampered = *link;
+        tampered.back() = 'x';
+        check(verifier.verify(tampered) == dplnk::verify_result::mismatch);
+    }
+
+    void rejections() {
+        const auto verifier = ::verifier();
+        check(verifier.verify("mygame://lobby?id=1") == dplnk::verify_result::unsigned_link);
+        check(verifier.verify("mygame://lobby?id=1&sig=!!") == dplnk::verify_result::malformed);
+
+        auto link = *verifier.sign("mygame://lobby?id=1", "2024");
+        check(verifier.verify(link.replace(link.find("id=1"), 4, "id=2")) == dplnk::verify_result::mismatch);
+
+        dplnk::link_verifier other;
+        check(other.verify(*verifier.sign("mygame://lobby", "2024")) == dplnk::verify_result::unknown_key);
+    }
+} // namespace
+
+int main() {
+    reference_hmac_matches_rfc_4231();
+    signed_links_verify();
+    fragments_stay_after_the_signature_and_are_signed();
+    rejections();
+    return dplnk::test::failures;
+}
@@ -0,0 +1,73 @@
+﻿#include "check.hpp"
+
+#include <dplnk/spool.h>
+
+#include <chrono>
+#include <filesystem>
+#include <set>
+#include <string>
+
+using dplnk::test::check;
+
+namespace {
+    std::filesystem::path scratch(const char* name) {
+        const auto path = std::filesystem::temp_directory_path() / ("dplnk-test-" + std::to_string(std::chrono::steady_clock::now().time_since_epoch().count()) + "-" + name);
+        std::filesystem::remove(path);
+        return path;
+    }
+
+    void a_backlog_larger_than_the_receiver_is_delivered_over_several_drains() {
+        const auto file = scratch("backlog");
+        {
+            dplnk::link_spool spool{ "game", { .file = file } };
+            for (int i = 0; i < 100; ++i) {
+                check(spool.append("game://room" + std::to_string(i), false));
+            }
+
+            dplnk::receiver receiver{ { .capacity = 16, .route_rate = 0.0, .total_rate = 0.0 } };
+            std::set<std::string> delivered;
+            int rounds = 0;
+            for (; rounds < 10 && !spool.empty(); ++rounds) {
+                check(spool.drain(receiver) == (rounds < 6 ? 16 : 4));
+                receiver.poll([&](std::string_view link) { delivered.emplace(link); });
+            }
+
+            check(rounds == 7);
+
+            check(spool.empty());
+            check(delivered.size() == 100);
+            check(receiver.stats().evicted == 0);
+            check(spool.stats().drained == 100);
+        }
+        std::filesystem::remove(file);
+    }
+
+    void rate_limited_links_stay_in_the_spool() {
+        const auto file = scratch("limited");
+        {
+            dplnk::link_spool spool{ "game", { .file = file } };
+            for (int i = 0; i < 50; ++i) {
+                check(spool.append("game://room" + std::to_string(i), false));
+            }
+
+            // The default total burst lets 32 through at once, the other 18 wait for a later drain
+            dplnk::receiver receiver;
+            check(spool.drain(receiver) == 32);
+            check(!spool.empty());
+            check(receiver.stats().rate_limited == 1);
+        }
+
+        // Still there for the next process
+        dplnk::link_spool reopened{ "game", { .file = file } };
+        dplnk::receiver receiver{ { .route_rate = 0.0, .total_rate = 0.0 } };
+        check(reopened.drain(receiver) == 18);
+        check(reopened.empty());
+        std::filesystem::remove(file);
+    }
+} // namespace
+
+int main() {
+    a_backlog_larger_than_the_receiver_is_delivered_over_several_drains();
+    rate_limited_links_stay_in_the_spool();
+    return dplnk::test::failures;
+}
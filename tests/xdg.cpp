@@ -0,0 +1,79 @@
+﻿#include "check.hpp"
+
+#include "xdg.hpp"
+
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <string>
+
+using dplnk::test::check;
+namespace xdg = dplnk::detail::xdg;
+
+namespace {
+    std::filesystem::path scratch(const char* name) {
+        const auto path = std::filesystem::temp_directory_path() / ("dplnk-test-" + std::to_string(std::chrono::steady_clock::now().time_since_epoch().count()) + "-" + name);
+        std::filesystem::create_directories(path);
+        return path;
+    }
+
+    void install(const std::filesystem::path& applications, const std::string& id, const std::string& mime) {
+        std::ofstream{ applications / id } << "[Desktop Entry]\nType=Application\nExec=/usr/bin/true %u\nMimeType=" << mime << ";\n";
+    }
+
+    void patched_cache_keys_stay_sorted() {
+        const auto applications = scratch("sorted");
+        install(applications, "b.desktop", "x-scheme-handler/b");
+        install(applications, "d.desktop", "x-scheme-handler/d");
+
+        const std::string cache = "[MIME Cache]\nx-scheme-handler/b=b.desktop;\nx-scheme-handler/d=d.desktop;\n";
+        check(xdg::patch_mimeinfo_cache(cache, { { "x-scheme-handler/c", "c.desktop" }, { "x-scheme-handler/a", "a.desktop" } }, applications)
+            == "[MIME Cache]\nx-scheme-handler/a=a.desktop;\nx-scheme-handler/b=b.desktop;\nx-scheme-handler/c=c.desktop;\nx-scheme-handler/d=d.desktop;\n");
+
+        std::filesystem::remove_all(applications);
+    }
+
+    void patched_cache_drops_ids_that_are_not_installed() {
+        const auto applications = scratch("installed");
+        install(applications, "kept.desktop", "x-scheme-handler/game");
+        // Still installed, but no longer declaring the type
+        install(applications, "moved.desktop", "x-scheme-handler/other");
+
+        const std::string cache = "[MIME Cache]\nx-scheme-handler/game=gone.desktop;kept.desktop;moved.desktop;\n";
+        check(xdg::patch_mimeinfo_cache(cache, { { "x-scheme-handler/game", "dplnk-game.desktop" } }, applications)
+            == "[MIME Cache]\nx-scheme-handler/game=kept.desktop;dplnk-game.desktop;\n");
+
+        std::filesystem::remove_all(applications);
+    }
+
+    void defaults_do_not_add_a_removed_associations_group() {
+        const std::string updated = xdg::set_default_handlers("[Default Applications]\ntext/html=firefox.desktop;\n", { { "x-scheme-handler/game", "dplnk-game.desktop" } });
+        check(updated.find("[Removed Associations]") == std::string::npos);
+        check(updated
+            == "[Default Applications]\ntext/html=firefox.desktop;\nx-scheme-handler/game=dplnk-game.desktop;\n\n"
+               "[Added Associations]\nx-scheme-handler/game=dplnk-game.desktop;\n");
+
+        // An existing removal of the handler is taken back, the rest of the group stays
+        const std::string removed = xdg::set_default_handlers("[Removed Associations]\nx-scheme-handler/game=dplnk-game.desktop;other.desktop;\n", { { "x-scheme-handler/game", "dplnk-game.desktop" } });
+        check(removed.starts_with("[Removed Associations]\nx-scheme-handler/game=other.desktop;\n"));
+    }
+
+    void removing_the_last_handler_drops_its_group() {
+        const std::string content = "[Default Applications]\nx-scheme-handler/game=dplnk-game.desktop;\n\n"
+                                    "[Added Associations]\nx-scheme-handler/game=dplnk-game.desktop;\ntext/html=firefox.desktop;\n\n"
+                                    "[Removed Associations]\n";
+        check(xdg::remove_handlers(content, { "dplnk-game.desktop" })
+            == "[Added Associations]\ntext/html=firefox.desktop;\n\n[Removed Associations]\n");
+
+        // A group that was empty to begin with is not ours to drop
+        check(xdg::remove_handlers("[Default Applications]\n", { "dplnk-game.desktop" }) == "[Default Applications]\n");
+    }
+} // namespace
+
+int main() {
+    patched_cache_keys_stay_sorted();
+    patched_cache_drops_ids_that_are_not_installed();
+    defaults_do_not_add_a_removed_associations_group();
+    removing_the_last_handler_drops_its_group();
+    return dplnk::test::failures;
+}
@@ -0,0 +1,176 @@
+﻿// dplnk-bench: throughput of the hot paths, one line per case
+#include <dplnk/base64.h>
+#include <dplnk/signature.h>
+#include <dplnk/transaction.h>
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <random>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace {
+    constexpr std::string_view usage = "usage: dplnk-bench [<case name substring>]\n";
+
+    // Kept by every case, so the compiler cannot drop the work being timed
+    volatile std::size_t sink = 0;
+
+    class runner {
+    public:
+        explicit runner(std::string_view filter) : filter{ filter } {}
+
+        // Repeats `operation` for at least `budget` after a warm-up, `bytes` is what one call processes
+        template<typename Operation>
+        void run(std::string_view name, std::size_t bytes, Operation&& operation) {
+            if (name.find(filter) == std::string_view::npos) {
+                return;
+            }
+
+            using clock = std::chrono::steady_clock;
+            for (int i = 0; i < 16; ++i) {
+                sink = sink + operation();
+            }
+
+            std::size_t iterations = 0;
+            const auto start = clock::now();
+            auto elapsed = clock::duration{};
+            for (std::size_t batch = 16; elapsed < budget; batch *= 2) {
+                for (std::size_t i = 0; i < batch; ++i) {
+                    sink = sink + operation();
+                }
+                iterations += batch;
+                elapsed = clock::now() - start;
+            }
+
+            const double seconds = std::chrono::duration<double>(elapsed).count();
+            const double per_call = seconds / static_cast<double>(iterations);
+            std::printf("%-36.*s %12.1f ns/op", static_cast<int>(name.size()), name.data(), per_call * 1e9);
+            if (bytes != 0) {
+                std::printf(" %10.1f MB/s", static_cast<double>(bytes) / per_call / 1e6);
+            }
+            std::printf("\n");
+        }
+
+        void skip(std::string_view name, std::string_view reason) const {
+            if (name.find(filter) != std::string_view::npos) {
+                std::printf("%-36.*s skipped (%.*s)\n", static_cast<int>(name.size()), name.data(), static_cast<int>(reason.size()), reason.data());
+            }
+        }
+
+    private:
+        static constexpr auto budget = std::chrono::milliseconds{ 200 };
+
+        std::string_view filter;
+    };
+
+    std::vector<std::byte> random_bytes(std::size_t size) {
+        std::mt19937 engine{ 2024 };
+        std::vector<std::byte> bytes(size);
+        for (auto& byte : bytes) {
+            byte = static_cast<std::byte>(engine());
+        }
+        return bytes;
+    }
+
+    void bench_base64(runner& runner) {
+        using dplnk::detail::base64_kernel;
+
+        constexpr struct {
+            std::string_view name;
+            base64_kernel kernel;
+        } kernels[] = { { "scalar", base64_kernel::scalar }, { "sse", base64_kernel::ssse3 }, { "avx2", base64_kernel::avx2 } };
+
+        // A session token, and a payload large enough that the loop dominates
+        for (const std::size_t size : { std::size_t{ 48 }, std::size_t{ 64 * 1024 } }) {
+            const auto bytes = random_bytes(size);
+            std::string encoded(dplnk::base64url_encoded_size(size), '\0');
+            std::vector<std::byte> decoded(size);
+            static_cast<void>(dplnk::base64url_encode(bytes, encoded));
+
+            for (const auto& [label, kernel] : kernels) {
+                const std::string encode = "base64/encode/" + std::to_string(size) + "/" + std::string{ label };
+                const std::string decode = "base64/decode/" + std::to_string(size) + "/" + std::string{ label };
+
+                if (!dplnk::detail::supports(kernel)) {
+                    runner.skip(encode, "not supported by this CPU");
+                    runner.skip(decode, "not supported by this CPU");
+                    continue;
+                }
+
+                runner.run(encode, size, [&] { return dplnk::detail::base64url_encode(bytes, encoded, kernel).value_or(0); });
+                runner.run(decode, size, [&] { return dplnk::detail::base64url_decode(encoded, decoded, kernel).value_or(0); });
+            }
+        }
+    }
+
+    void bench_signature(runner& runner) {
+        constexpr std::string_view secret = "a secret that is shared with the server";
+        const auto key = std::as_bytes(std::span{ secret.data(), secret.size() });
+
+        dplnk::link_verifier verifier;
+        verifier.add_key("2024", key);
+        const std::string link = *verifier.sign("mygame://lobby/join?id=4711&region=eu&invite=7f3a9c2e", "2024");
+
+        runner.run("signature/verify/precomputed", 0, [&] { return static_cast<std::size_t>(verifier.verify(link)); });
+
+        // The same checks with both pads hashed again for every link
+        runner.run("signature/verify/naive", 0, [&] {
+            const auto at = link.rfind("&sig=");
+            std::array<std::byte, 32> expected;
+            if (dplnk::base64url_decode(std::string_view{ link }.substr(at + 5), expected).value_or(0) != expected.size()) {
+                return std::size_t{ 0 };
+            }
+
+            const auto actual = dplnk::detail::hmac_sha256(key, std::string_view{ link }.substr(0, at));
+            std::byte difference{ 0 };
+            for (std::size_t i = 0; i < actual.size(); ++i) {
+                difference |= actual[i] ^ expected[i];
+            }
+            return static_cast<std::size_t>(difference);
+        });
+    }
+
+    // Bulk registration into a scratch XDG home under the temporary directory (TMPDIR), so the syncs hit that disk
+    void bench_transaction(runner& runner) {
+#ifdef __linux__
+        const auto home = std::filesystem::temp_directory_path() / "dplnk-bench-home";
+        std::filesystem::remove_all(home);
+        setenv("XDG_DATA_HOME", (home / "data").c_str(), 1);
+        setenv("XDG_CONFIG_HOME", (home / "config").c_str(), 1);
+
+        for (const std::size_t schemes : { 1, 8, 32 }) {
+            const std::string name = "transaction/commit/" + std::to_string(schemes);
+            runner.run(name, 0, [&] {
+                dplnk::registration_transaction transaction;
+                for (std::size_t i = 0; i < schemes; ++i) {
+                    transaction.add("/opt/bench/run", { "bench" + std::to_string(i), std::nullopt });
+                }
+                return transaction.try_commit().value().writes;
+            });
+        }
+
+        std::filesystem::remove_all(home);
+#else
+        runner.skip("transaction/commit", "Linux only");
+#endif
+    }
+} // namespace
+
+int main(int argc, char** argv) {
+    if (argc > 2) {
+        std::fputs(usage.data(), stderr);
+        return 2;
+    }
+
+    runner runner{ argc == 2 ? std::string_view{ argv[1] } : std::string_view{} };
+    bench_base64(runner);
+    bench_signature(runner);
+    bench_transaction(runner);
+    return 0;
+}
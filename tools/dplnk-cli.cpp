@@ -0,0 +1,416 @@
+﻿// dplnk-cli: registers, removes and checks schemes in bulk from a manifest, reporting JSON lines on stdout
+#include <dplnk/dplnk.h>
+#include <dplnk/lookup.h>
+#include <dplnk/transaction.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+namespace {
+    constexpr std::string_view usage =
+        "usage: dplnk-cli <register|unregister|query|verify|bench> [--manifest <file>|-] [--batch <entries>] [--threads <count>]\n"
+        "\n"
+        "The manifest has one scheme per line: <protocol> <TAB> <path> [<TAB> <key>=<value>]...\n"
+        "Blank lines and lines starting with '#' are skipped; `unregister` and `query` only need the protocol.\n";
+
+    struct entry {
+        std::size_t line = 0;
+        dplnk::options options;
+        std::string path;
+        // Set when the line itself is malformed
+        std::string error;
+    };
+
+    struct outcome {
+        // "ok", or what went wrong: "error", "missing", "mismatch"
+        std::string_view status = "ok";
+        std::string detail;
+        std::optional<dplnk::registration_info> info;
+    };
+
+    // Reads the manifest a batch at a time, so its size is bounded by `batch` rather than by the file
+    class manifest_reader {
+    public:
+        explicit manifest_reader(std::istream& in) noexcept : in{ in } {}
+
+        bool next(std::vector<entry>& batch, std::size_t size) {
+            batch.clear();
+
+            std::string text;
+            while (batch.size() < size && std::getline(in, text)) {
+                ++line;
+                if (!text.empty() && text.back() == '\r') {
+                    text.pop_back();
+                }
+                if (text.empty() || text.front() == '#') {
+                    continue;
+                }
+
+                batch.push_back(parse(text));
+            }
+
+            return !batch.empty();
+        }
+
+    private:
+        entry parse(std::string_view text) const {
+            entry parsed;
+            parsed.line = line;
+
+            std::vector<std::string_view> fields;
+            for (std::size_t tab; (tab = text.find('\t')) != std::string_view::npos; text.remove_prefix(tab + 1)) {
+                fields.push_back(text.substr(0, tab));
+            }
+            fields.push_back(text);
+
+            parsed.options.protocol = fields[0];
+            if (fields.size() > 1) {
+                parsed.path = fields[1];
+            }
+
+            for (std::size_t i = 2; i < fields.size(); ++i) {
+                const auto equals = fields[i].find('=');
+                if (equals == std::string_view::npos) {
+                    parsed.error = "expected <key>=<value>, got '" + std::string{ fields[i] } + "'";
+                    break;
+                }
+                if (!parsed.options.d.has_value()) {
+                    parsed.options.d.emplace();
+                }
+                parsed.options.d->insert_or_assign(std::string{ fields[i].substr(0, equals) }, std::string{ fields[i].substr(equals + 1) });
+            }
+
+            if (parsed.error.empty() && !dplnk::is_valid_scheme(parsed.options.protocol)) {
+                parsed.error = "'" + parsed.options.protocol + "' is not a valid URL scheme";
+            }
+
+            return parsed;
+        }
+
+        std::istream& in;
+        std::size_t line = 0;
+    };
+
+    std::string json_string(std::string_view text) {
+        std::string quoted = "\"";
+        for (const char c : text) {
+            switch (c) {
+            case '"':
+                quoted += "\\\"";
+                break;
+            case '\\':
+                quoted += "\\\\";
+                break;
+            case '\n':
+                quoted += "\\n";
+                break;
+            case '\t':
+                quoted += "\\t";
+                break;
+            default:
+                if (static_cast<unsigned char>(c) < 0x20) {
+                    char escaped[8];
+                    std::snprintf(escaped, sizeof(escaped), "\\u%04x", static_cast<unsigned>(c));
+                    quoted += escaped;
+                } else {
+                    quoted += c;
+                }
+            }
+        }
+        return quoted += '"';
+    }
+
+    struct totals {
+        std::size_t entries = 0;
+        std::size_t ok = 0;
+        std::chrono::steady_clock::duration elapsed{};
+    };
+
+    void report(const entry& entry, const outcome& outcome, totals& totals) {
+        ++totals.entries;
+        if (outcome.status == "ok") {
+            ++totals.ok;
+        }
+
+        std::string line = "{\"line\":" + std::to_string(entry.line) + ",\"protocol\":" + json_string(entry.options.protocol)
+            + ",\"status\":" + json_string(outcome.status);
+        if (!outcome.detail.empty()) {
+            line += ",\"detail\":" + json_string(outcome.detail);
+        }
+        if (outcome.info.has_value()) {
+            line += ",\"handler\":" + json_string(outcome.info->handler) + ",\"command\":" + json_string(outcome.info->command)
+                + ",\"path\":" + json_string(outcome.info->path);
+        }
+        std::cout << line << "}\n";
+    }
+
+    void summarize(std::string_view command, const totals& totals) {
+        const double seconds = std::chrono::duration<double>(totals.elapsed).count();
+        std::cout << "{\"summary\":" << json_string(command) << ",\"entries\":" << totals.entries << ",\"ok\":" << totals.ok
+                  << ",\"failed\":" << totals.entries - totals.ok << ",\"seconds\":" << seconds
+                  << ",\"per_second\":" << (seconds > 0 ? static_cast<double>(totals.entries) / seconds : 0.0) << "}\n";
+    }
+
+    // Registrations of a batch go through one transaction: one sync, and all or none of the valid entries
+    void register_batch(const std::vector<entry>& batch, std::vector<outcome>& outcomes) {
+        dplnk::registration_transaction transaction;
+        for (std::size_t i = 0; i < batch.size(); ++i) {
+            if (batch[i].path.empty() && batch[i].error.empty()) {
+                outcomes[i] = { "error", "missing the program path", std::nullopt };
+            } else if (!batch[i].error.empty()) {
+                outcomes[i] = { "error", batch[i].error, std::nullopt };
+            } else {
+                transaction.add(batch[i].path, batch[i].options);
+            }
+        }
+
+        try {
+            transaction.commit();
+        } catch (const std::exception& e) {
+            for (auto& outcome : outcomes) {
+                if (outcome.status == "ok") {
+                    outcome = { "error", e.what(), std::nullopt };
+                }
+            }
+        }
+    }
+
+    void unregister_batch(const std::vector<entry>& batch, std::vector<outcome>& outcomes) {
+        std::vector<std::string> protocols;
+        for (std::size_t i = 0; i < batch.size(); ++i) {
+            if (!batch[i].error.empty()) {
+                outcomes[i] = { "error", batch[i].error, std::nullopt };
+            } else {
+                protocols.push_back(batch[i].options.protocol);
+            }
+        }
+
+        try {
+            dplnk::unregister(protocols);
+        } catch (const std::exception& e) {
+            for (auto& outcome : outcomes) {
+                if (outcome.status == "ok") {
+                    outcome = { "error", e.what(), std::nullopt };
+                }
+            }
+        }
+    }
+
+    // Lookups only read the shared index, so they are spread over threads
+    void lookup_batch(const std::vector<entry>& batch, std::vector<outcome>& outcomes, bool verify, std::size_t threads) {
+        const auto index = dplnk::scheme_index::current();
+
+        const auto check = [&](std::size_t i) {
+            const entry& entry = batch[i];
+            if (!entry.error.empty()) {
+                outcomes[i] = { "error", entry.error, std::nullopt };
+                return;
+            }
+
+            const dplnk::registration_info* info = index->find(entry.options.protocol);
+            if (info == nullptr) {
+                outcomes[i] = { "missing", {}, std::nullopt };
+                return;
+            }
+            outcomes[i].info = *info;
+
+            if (!verify) {
+                return;
+            }
+            if (info->path != entry.path) {
+                outcomes[i].status = "mismatch";
+                outcomes[i].detail = "registered for '" + info->path + "'";
+                return;
+            }
+            if (entry.options.d.has_value()) {
+                for (const auto& [key, value] : *entry.options.d) {
+                    const auto it = info->d.find(key);
+                    if (it == info->d.end() || it->second != value) {
+                        outcomes[i].status = "mismatch";
+                        outcomes[i].detail = "value '" + key + "' differs";
+                        return;
+                    }
+                }
+            }
+        };
+
+        const std::size_t workers = std::min(threads, batch.size());
+        std::vector<std::jthread> pool;
+        pool.reserve(workers);
+        for (std::size_t w = 0; w < workers; ++w) {
+            pool.emplace_back([&, w] {
+                for (std::size_t i = w; i < batch.size(); i += workers) {
+                    check(i);
+                }
+            });
+        }
+    }
+
+    struct settings {
+        std::string command;
+        std::string manifest = "-";
+        std::size_t batch = 512;
+        std::size_t threads = std::max(1u, std::thread::hardware_concurrency());
+    };
+
+    totals run(std::string_view command, std::istream& in, const settings& settings) {
+        manifest_reader reader{ in };
+        std::vector<entry> batch;
+        std::vector<outcome> outcomes;
+        totals totals;
+
+        while (reader.next(batch, settings.batch)) {
+            outcomes.assign(batch.size(), {});
+
+            const auto start = std::chrono::steady_clock::now();
+            if (command == "register") {
+                register_batch(batch, outcomes);
+            } else if (command == "unregister") {
+                unregister_batch(batch, outcomes);
+            } else {
+                lookup_batch(batch, outcomes, command == "verify", settings.threads);
+            }
+            totals.elapsed += std::chrono::steady_clock::now() - start;
+
+            for (std::size_t i = 0; i < batch.size(); ++i) {
+                report(batch[i], outcomes[i], totals);
+            }
+        }
+
+        return totals;
+    }
+
+    // Registers, verifies and removes the manifest once and reports each phase's throughput. On Linux the
+    // registrations go to a scratch XDG data and config home; elsewhere only the read-only phases run.
+    int bench(const settings& settings) {
+        std::string manifest;
+        {
+            std::ifstream file;
+            std::istream& in = settings.manifest == "-" ? std::cin : (file.open(settings.manifest), file);
+            manifest.assign(std::istreambuf_iterator<char>{ in }, std::istreambuf_iterator<char>{});
+        }
+
+#ifdef __linux__
+        const auto scratch = std::filesystem::temp_directory_path() / ("dplnk-bench-" + std::to_string(std::chrono::steady_clock::now().time_since_epoch().count()));
+        std::filesystem::create_directories(scratch);
+        setenv("XDG_DATA_HOME", (scratch / "data").c_str(), 1);
+        setenv("XDG_CONFIG_HOME", (scratch / "config").c_str(), 1);
+        setenv("XDG_DATA_DIRS", (scratch / "none").c_str(), 1);
+        setenv("XDG_CONFIG_DIRS", (scratch / "none").c_str(), 1);
+        dplnk::scheme_index::invalidate();
+
+        const std::vector<std::string_view> phases{ "register", "query", "verify", "unregister" };
+#else
+        const std::vector<std::string_view> phases{ "query", "verify" };
+#endif
+
+        // Phases print their summaries only, the per-entry lines would drown them
+        auto* const entries = std::cout.rdbuf();
+        std::ostringstream discard;
+        for (const auto phase : phases) {
+            std::istringstream in{ manifest };
+            std::cout.rdbuf(discard.rdbuf());
+
+            if (phase == "query" || phase == "verify") {
+                const auto start = std::chrono::steady_clock::now();
+                dplnk::scheme_index::invalidate();
+                static_cast<void>(dplnk::scheme_index::current());
+                const std::chrono::duration<double> built = std::chrono::steady_clock::now() - start;
+                std::cout.rdbuf(entries);
+                if (phase == "query") {
+                    std::cout << "{\"summary\":\"index\",\"seconds\":" << built.count() << "}\n";
+                }
+                std::cout.rdbuf(discard.rdbuf());
+            }
+
+            const totals totals = run(phase, in, settings);
+            discard.str({});
+            std::cout.rdbuf(entries);
+            summarize(phase, totals);
+        }
+
+#ifdef __linux__
+        std::error_code error;
+        std::filesystem::remove_all(scratch, error);
+#endif
+        return 0;
+    }
+} // namespace
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        std::cerr << usage;
+        return 2;
+    }
+
+    settings settings;
+    settings.command = argv[1];
+
+    for (int i = 2; i < argc; ++i) {
+        const std::string_view argument = argv[i];
+        if (i + 1 == argc) {
+            std::cerr << usage;
+            return 2;
+        }
+
+        const std::string value = argv[++i];
+        if (argument == "--manifest") {
+            settings.manifest = value;
+        } else if (argument == "--batch" || argument == "--threads") {
+            const auto count = std::strtoull(value.c_str(), nullptr, 10);
+            if (count == 0) {
+                std::cerr << "dplnk-cli: " << argument << " expects a positive number\n";
+                return 2;
+            }
+            (argument == "--batch" ? settings.batch : settings.threads) = static_cast<std::size_t>(count);
+        } else {
+            std::cerr << usage;
+            return 2;
+        }
+    }
+
+    const std::string_view command = settings.command;
+    if (command != "register" && command != "unregister" && command != "query" && command != "verify" && command != "bench") {
+        std::cerr << usage;
+        return 2;
+    }
+
+    std::ios::sync_with_stdio(false);
+
+    try {
+        if (command == "bench") {
+            return bench(settings);
+        }
+
+        std::ifstream file;
+        if (settings.manifest != "-") {
+            file.open(settings.manifest);
+            if (!file) {
+                std::cerr << "dplnk-cli: cannot open '" << settings.manifest << "'\n";
+                return 1;
+            }
+        }
+
+        const totals totals = run(command, settings.manifest == "-" ? std::cin : file, settings);
+        summarize(command, totals);
+
+        // Missing or mismatched schemes fail `query` and `verify` the same way errors fail the rest
+        return totals.ok == totals.entries ? 0 : 1;
+    } catch (const std::exception& e) {
+        std::cerr << "dplnk-cli: " << e.what() << '\n';
+        return 1;
+    }
+}
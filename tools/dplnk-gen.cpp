@@ -0,0 +1,112 @@
+﻿// dplnk-gen: writes the registration artifacts of a scheme at build time, see `dplnk_generate_registration`
+#include <dplnk/artifacts.h>
+
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+namespace {
+    constexpr std::string_view usage =
+        "usage: dplnk-gen --protocol <scheme> --path <installed program> [--value <key>=<value>]... [--output <directory>]\n";
+
+    // regedit reads "Version 5.00" scripts as UTF-16LE with a byte order mark
+    std::string utf16le(std::string_view text) {
+        std::string encoded = "\xFF\xFE";
+
+        const auto put = [&](char32_t unit) {
+            encoded += static_cast<char>(unit & 0xFF);
+            encoded += static_cast<char>((unit >> 8) & 0xFF);
+        };
+
+        for (std::size_t i = 0; i < text.size();) {
+            const auto lead = static_cast<unsigned char>(text[i]);
+            const std::size_t length = lead < 0x80 ? 1 : lead < 0xE0 ? 2 : lead < 0xF0 ? 3 : 4;
+            if (i + length > text.size()) {
+                throw std::invalid_argument("Truncated UTF-8 sequence");
+            }
+
+            char32_t code = length == 1 ? lead : lead & (0x7F >> length);
+            for (std::size_t k = 1; k < length; ++k) {
+                code = (code << 6) | (static_cast<unsigned char>(text[i + k]) & 0x3F);
+            }
+            i += length;
+
+            if (code >= 0x10000) {
+                code -= 0x10000;
+                put(0xD800 + (code >> 10));
+                put(0xDC00 + (code & 0x3FF));
+            } else {
+                put(code);
+            }
+        }
+
+        return encoded;
+    }
+
+    void write(const std::filesystem::path& file, std::string_view content) {
+        std::ofstream out{ file, std::ios::binary | std::ios::trunc };
+        out.write(content.data(), static_cast<std::streamsize>(content.size()));
+        if (!out) {
+            throw std::runtime_error("Cannot write '" + file.string() + "'");
+        }
+    }
+} // namespace
+
+int main(int argc, char** argv) {
+    dplnk::options options;
+    std::string path;
+    std::filesystem::path output = ".";
+
+    for (int i = 1; i < argc; ++i) {
+        const std::string_view argument = argv[i];
+        if (i + 1 == argc) {
+            std::cerr << usage;
+            return 2;
+        }
+
+        const std::string_view value = argv[++i];
+        if (argument == "--protocol") {
+            options.protocol = value;
+        } else if (argument == "--path") {
+            path = value;
+        } else if (argument == "--output") {
+            output = value;
+        } else if (argument == "--value") {
+            const auto equals = value.find('=');
+            if (equals == std::string_view::npos) {
+                std::cerr << "dplnk-gen: --value expects <key>=<value>, got '" << value << "'\n";
+                return 2;
+            }
+            if (!options.d.has_value()) {
+                options.d.emplace();
+            }
+            options.d->insert_or_assign(std::string{ value.substr(0, equals) }, std::string{ value.substr(equals + 1) });
+        } else {
+            std::cerr << usage;
+            return 2;
+        }
+    }
+
+    if (options.protocol.empty() || path.empty()) {
+        std::cerr << usage;
+        return 2;
+    }
+
+    try {
+        const auto artifacts = dplnk::generate_registration(path, options);
+
+        std::filesystem::create_directories(output);
+        write(output / (options.protocol + ".reg"), utf16le(artifacts.reg));
+        write(output / artifacts.desktop_file_name, artifacts.desktop_file);
+        write(output / (options.protocol + "-mimeapps.list"), artifacts.mimeapps);
+    } catch (const std::exception& e) {
+        std::cerr << "dplnk-gen: " << e.what() << '\n';
+        return 1;
+    }
+
+    return 0;
+}